@@ -0,0 +1,22 @@
+TEMPLATE = app
+TARGET = QSanguosha-selfplay
+
+QT -= gui
+QT += network
+CONFIG += console
+CONFIG -= app_bundle
+
+include(QSanguosha.pri)
+
+SOURCES += \
+    src/selfplay/cardareabenchmark.cpp \
+    src/selfplay/main.cpp \
+    src/selfplay/selfplayrule.cpp \
+    src/selfplay/simulation.cpp
+
+HEADERS += \
+    src/selfplay/cardareabenchmark.h \
+    src/selfplay/selfplayrule.h \
+    src/selfplay/simulation.h
+
+INCLUDEPATH += src/selfplay
@@ -0,0 +1,21 @@
+TEMPLATE = app
+TARGET = QSanguosha-server
+
+QT -= gui
+QT += network
+CONFIG += console
+CONFIG -= app_bundle
+
+include(QSanguosha.pri)
+
+SOURCES += \
+    src/server/dedicatedserver.cpp \
+    src/server/main.cpp
+
+HEADERS += \
+    src/server/dedicatedserver.h
+
+INCLUDEPATH += src/server
+
+# Default rules for deployment.
+include(deployment.pri)
@@ -0,0 +1,81 @@
+# Game core, logic and packages shared by the client and the dedicated server
+
+CONFIG += c++11
+
+SOURCES += \
+    src/core/card.cpp \
+    src/core/cardarea.cpp \
+    src/core/cardtable.cpp \
+    src/core/cardpattern.cpp \
+    src/core/coroutine.cpp \
+    src/core/engine.cpp \
+    src/core/general.cpp \
+    src/core/package.cpp \
+    src/core/player.cpp \
+    src/core/playerring.cpp \
+    src/core/protocol.cpp \
+    src/core/randomgenerator.cpp \
+    src/core/skill.cpp \
+    src/core/stringpool.cpp \
+    src/core/structs.cpp \
+    src/core/util.cpp \
+    src/core/wireformat.cpp \
+    src/gamelogic/event.cpp \
+    src/gamelogic/eventdata.cpp \
+    src/gamelogic/eventhandler.cpp \
+    src/gamelogic/gamejournal.cpp \
+    src/gamelogic/gamelogic.cpp \
+    src/gamelogic/gamerule.cpp \
+    src/gamelogic/logicscheduler.cpp \
+    src/gamelogic/serverplayer.cpp \
+    src/package/standardpackage.cpp \
+    src/package/standard-basiccard.cpp \
+    src/package/standard-equipcard.cpp \
+    src/package/standard-qun.cpp \
+    src/package/standard-shu.cpp \
+    src/package/standard-trickcard.cpp \
+    src/package/standard-wei.cpp \
+    src/package/standard-wu.cpp \
+    src/package/systempackage.cpp
+
+HEADERS += \
+    src/core/card.h \
+    src/core/cardarea.h \
+    src/core/cardtable.h \
+    src/core/cardpattern.h \
+    src/core/coroutine.h \
+    src/core/engine.h \
+    src/core/general.h \
+    src/core/package.h \
+    src/core/player.h \
+    src/core/playerring.h \
+    src/core/protocol.h \
+    src/core/randomgenerator.h \
+    src/core/skill.h \
+    src/core/stringpool.h \
+    src/core/structs.h \
+    src/core/util.h \
+    src/core/wireformat.h \
+    src/gamelogic/event.h \
+    src/gamelogic/eventdata.h \
+    src/gamelogic/eventhandler.h \
+    src/gamelogic/eventtype.h \
+    src/gamelogic/gamejournal.h \
+    src/gamelogic/gamelogic.h \
+    src/gamelogic/gamerule.h \
+    src/gamelogic/logicscheduler.h \
+    src/gamelogic/serverplayer.h \
+    src/package/standardpackage.h \
+    src/package/standard-basiccard.h \
+    src/package/systempackage.h
+
+INCLUDEPATH += src \
+    src/core \
+    src/gamelogic \
+    src/package
+
+DEFINES += MCD_STATIC
+#DEFINES += MCD_BUILD
+INCLUDEPATH += $$PWD/Cardirector/include
+LIBS += -L"$$PWD/Cardirector/lib"
+LIBS += -l$$qtLibraryTarget(Cardirector)
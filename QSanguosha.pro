@@ -1,80 +1,28 @@
 TEMPLATE = app
 
 QT += qml quick
-CONFIG += c++11
+
+include(QSanguosha.pri)
 
 SOURCES += src/main.cpp \
     src/client/client.cpp \
     src/client/clientplayer.cpp \
-    src/core/card.cpp \
-    src/core/cardarea.cpp \
-    src/core/cardpattern.cpp \
-    src/core/engine.cpp \
-    src/core/general.cpp \
-    src/core/package.cpp \
-    src/core/player.cpp \
-    src/core/protocol.cpp \
-    src/core/skill.cpp \
-    src/core/structs.cpp \
-    src/core/util.cpp \
-    src/gamelogic/event.cpp \
-    src/gamelogic/eventhandler.cpp \
-    src/gamelogic/gamelogic.cpp \
-    src/gamelogic/gamerule.cpp \
-    src/gamelogic/serverplayer.cpp \
     src/gui/dialog/startserverdialog.cpp \
     src/gui/dialog/startgamedialog.cpp \
     src/gui/lobby.cpp \
-    src/gui/roomscene.cpp \
-    src/package/standardpackage.cpp \
-    src/package/standard-basiccard.cpp \
-    src/package/standard-equipcard.cpp \
-    src/package/standard-qun.cpp \
-    src/package/standard-shu.cpp \
-    src/package/standard-trickcard.cpp \
-    src/package/standard-wei.cpp \
-    src/package/standard-wu.cpp \
-    src/package/systempackage.cpp
+    src/gui/roomscene.cpp
 
 HEADERS += \
     src/client/client.h \
     src/client/clientplayer.h \
-    src/core/card.h \
-    src/core/cardarea.h \
-    src/core/cardpattern.h \
-    src/core/engine.h \
-    src/core/general.h \
-    src/core/package.h \
-    src/core/player.h \
-    src/core/protocol.h \
-    src/core/skill.h \
-    src/core/structs.h \
-    src/core/util.h \
-    src/gamelogic/event.h \
-    src/gamelogic/eventhandler.h \
-    src/gamelogic/eventtype.h \
-    src/gamelogic/gamelogic.h \
-    src/gamelogic/gamerule.h \
-    src/gamelogic/serverplayer.h \
     src/gui/dialog/startserverdialog.h \
     src/gui/dialog/startgamedialog.h \
     src/gui/lobby.h \
-    src/gui/roomscene.h \
-    src/package/standardpackage.h \
-    src/package/standard-basiccard.h \
-    src/package/systempackage.h
+    src/gui/roomscene.h
 
-INCLUDEPATH += src \
+INCLUDEPATH += \
     src/client \
-    src/core \
-    src/gamelogic \
-    src/gui \
-    src/package
-
-DEFINES += MCD_STATIC
-#DEFINES += MCD_BUILD
-INCLUDEPATH += Cardirector/include
-LIBS += -L"$$_PRO_FILE_PWD_/Cardirector/lib"
+    src/gui
 
 defineTest(copy) {
     file = $$1
@@ -106,8 +54,6 @@ android {
     !contains(DEFINES, MCD_STATIC): ANDROID_EXTRA_LIBS += $$PWD/Cardirector/lib/libCardirector.so
 }
 
-LIBS += -l$$qtLibraryTarget(Cardirector)
-
 # Additional import path used to resolve QML modules in Qt Creator's code model
 QML_IMPORT_PATH = $$PWD
 
@@ -22,6 +22,8 @@
 #include "clientplayer.h"
 #include "engine.h"
 #include "protocol.h"
+#include "stringpool.h"
+#include "wireformat.h"
 
 #include <cclientuser.h>
 
@@ -82,10 +84,17 @@ void Client::restart()
     foreach (ClientPlayer *player, m_players)
         player->deleteLater();
     m_players.clear();
+    m_user2player.clear();
+    m_ring.clear();
+    m_cardTable.clear();
+}
 
-    foreach (Card *card, m_cards)
-        delete card;
-    m_cards.clear();
+void Client::readArea(WireReader &reader, CardsMoveStruct::Area &area)
+{
+    area.type = static_cast<CardArea::Type>(reader.readByte());
+    area.direction = static_cast<CardArea::Direction>(reader.readByte());
+    area.owner = findPlayer(reader.readVarint());
+    area.name = reader.readString();
 }
 
 CardArea *Client::findArea(const CardsMoveStruct::Area &area)
@@ -109,13 +118,33 @@ CardArea *Client::findArea(const CardsMoveStruct::Area &area)
 
 void Client::ArrangeSeatCommand(QObject *receiver, const QVariant &data)
 {
-    QVariantList infos = data.toList();
+    QVariantList infos;
+    if (WireReader::isBinary(data)) {
+        WireReader reader(data);
+        int seatNum = reader.isValid() ? reader.readVarint() : 0;
+        for (int i = 0; i < seatNum && reader.isValid(); i++) {
+            QVariantMap info;
+            quint8 kind = reader.readByte();
+            if (kind == 1)
+                info["userId"] = reader.readVarint();
+            else if (kind == 2)
+                info["robotId"] = reader.readVarint();
+            info["playerId"] = reader.readVarint();
+            infos << info;
+        }
+        if (!reader.isValid()) {
+            qWarning("Malformed seats received");
+            return;
+        }
+    } else {
+        infos = data.toList();
+    }
     if (infos.isEmpty())
         return;
 
     Client *client = qobject_cast<Client *>(receiver);
 
-    QList<ClientPlayer *> players;
+    QList<Player *> players;
     players.reserve(infos.length());
 
     foreach (const QVariant &rawInfo, infos) {
@@ -126,6 +155,7 @@ void Client::ArrangeSeatCommand(QObject *receiver, const QVariant &data)
 
             ClientPlayer *player = new ClientPlayer(user, client);
             player->setId(info["playerId"].toUInt());
+            player->setCardTable(&client->m_cardTable);
             client->m_players[player->id()] = player;
             client->m_user2player[user] = player;
             player->setScreenName(user->screenName());
@@ -133,21 +163,18 @@ void Client::ArrangeSeatCommand(QObject *receiver, const QVariant &data)
             players << player;
         } else if (info.contains("robotId")) {
             //@to-do:
-        }
-    }
+        } else {
+            //The client of the player left the game
+            ClientPlayer *player = new ClientPlayer(nullptr, client);
+            player->setId(info["playerId"].toUInt());
+            player->setCardTable(&client->m_cardTable);
+            client->m_players[player->id()] = player;
 
-    if (!players.isEmpty()) {
-        for (int i = 1; i < infos.length(); i++) {
-            Player *prev = players.at(i - 1);
-            prev->setSeat(i);
-            prev->setNext(players.at(i));
+            players << player;
         }
-
-        Player *last = players.last();
-        last->setSeat(players.length());
-        last->setNext(players.first());
     }
 
+    client->m_ring.arrange(players);
 
     emit client->seatArranged();
 }
@@ -160,23 +187,39 @@ void Client::PrepareCardsCommand(QObject *receiver, const QVariant &data)
     foreach (const QVariant &cardId, cardData) {
         const Card *card = engine->getCard(cardId.toUInt());
         if (card)
-            client->m_cards[card->id()] = card->clone();
+            client->m_cardTable.add(card);
     }
 }
 
 void Client::UpdatePlayerPropertyCommand(QObject *receiver, const QVariant &data)
 {
-    QVariantList dataList = data.toList();
-    if (dataList.length() != 3)
-        return;
-
     Client *client = qobject_cast<Client *>(receiver);
-    uint playerId = dataList.at(0).toUInt();
-    ClientPlayer *player = client->m_players.value(playerId);
-    if (player) {
-        QString name = dataList.at(1).toString();
-        QVariant value = dataList.at(2);
-        player->setProperty(name.toLatin1().constData(), value);
+
+    WireReader reader(data);
+    if (reader.isValid()) {
+        //A batch of (player id, property id, value)
+        int changeNum = reader.readVarint();
+        for (int i = 0; i < changeNum; i++) {
+            uint playerId = reader.readVarint();
+            Player::Property property = static_cast<Player::Property>(reader.readVarint());
+            QVariant value = reader.readVariant();
+            if (!reader.isValid())
+                return;
+
+            ClientPlayer *player = client->m_players.value(playerId);
+            if (player)
+                player->updateProperty(property, value);
+        }
+    } else {
+        QVariantList dataList = data.toList();
+        if (dataList.length() != 3)
+            return;
+
+        ClientPlayer *player = client->m_players.value(dataList.at(0).toUInt());
+        if (player) {
+            QString name = dataList.at(1).toString();
+            player->setProperty(name.toLatin1().constData(), dataList.at(2));
+        }
     }
 }
 
@@ -204,49 +247,95 @@ void Client::MoveCardsCommand(QObject *receiver, const QVariant &data)
 
     QList<CardsMoveStruct> moves;
 
-    QVariantList movesData = data.toList();
-    foreach (const QVariant &moveVar, movesData) {
-        const QVariantMap moveData = moveVar.toMap();
-        const QVariantMap from = moveData["from"].toMap();
-        const QVariantMap to = moveData["to"].toMap();
-
-        CardsMoveStruct move;
-        move.from.type = static_cast<CardArea::Type>(from["type"].toInt());
-        move.from.direction = static_cast<CardArea::Direction>(from["direction"].toInt());
-        move.from.name = from["name"].toString();
-        move.from.owner = client->findPlayer(from["ownerId"].toUInt());
-        move.to.type = static_cast<CardArea::Type>(to["type"].toInt());
-        move.to.direction = static_cast<CardArea::Direction>(from["direction"].toInt());
-        move.to.name = to["name"].toString();
-        move.to.owner = client->findPlayer(to["ownerId"].toInt());
-        move.isOpen = to["isOpen"].toBool();
-        move.isLastHandCard = to["isLastHandCard"].toBool();
-
-        const QVariantList cards = moveData["cards"].toList();
-        if (cards.isEmpty()) {
-            int cardNum = moveData["cards"].toInt();
+    WireReader reader(data);
+    if (reader.isValid()) {
+        int moveNum = reader.readVarint();
+        for (int i = 0; i < moveNum && reader.isValid(); i++) {
+            CardsMoveStruct move;
+            client->readArea(reader, move.from);
+            client->readArea(reader, move.to);
+            move.isOpen = reader.readBool();
+            move.isLastHandCard = reader.readBool();
+
+            bool shown = reader.readBool();
+            int cardNum = reader.readVarint();
             move.cards.reserve(cardNum);
-            for (int i = 0; i < cardNum; i++)
-                move.cards << nullptr;
-        } else {
-            foreach (const QVariant &cardData, cards) {
-                Card *card = client->m_cards.value(cardData.toUInt());
-                if (card)
-                    move.cards << card;
-                else
-                    qWarning("Unknown card id received: %u", cardData.toUInt());
+            for (int j = 0; j < cardNum && reader.isValid(); j++) {
+                if (shown) {
+                    uint cardId = reader.readVarint();
+                    const Card *card = client->m_cardTable.card(cardId);
+                    if (card)
+                        move.cards << card;
+                    else
+                        qWarning("Unknown card id received: %u", cardId);
+                } else {
+                    move.cards << nullptr;
+                }
+            }
+
+            moves << move;
+        }
+
+        if (!reader.isValid()) {
+            qWarning("Malformed card moves received");
+            return;
+        }
+    } else {
+        QVariantList movesData = data.toList();
+        foreach (const QVariant &moveVar, movesData) {
+            const QVariantMap moveData = moveVar.toMap();
+            const QVariantMap from = moveData["from"].toMap();
+            const QVariantMap to = moveData["to"].toMap();
+
+            CardsMoveStruct move;
+            move.from.type = static_cast<CardArea::Type>(from["type"].toInt());
+            move.from.direction = static_cast<CardArea::Direction>(from["direction"].toInt());
+            move.from.name = from["name"].toString();
+            move.from.owner = client->findPlayer(from["ownerId"].toUInt());
+            move.to.type = static_cast<CardArea::Type>(to["type"].toInt());
+            move.to.direction = static_cast<CardArea::Direction>(from["direction"].toInt());
+            move.to.name = to["name"].toString();
+            move.to.owner = client->findPlayer(to["ownerId"].toInt());
+            move.isOpen = to["isOpen"].toBool();
+            move.isLastHandCard = to["isLastHandCard"].toBool();
+
+            const QVariantList cards = moveData["cards"].toList();
+            if (cards.isEmpty()) {
+                int cardNum = moveData["cards"].toInt();
+                move.cards.reserve(cardNum);
+                for (int i = 0; i < cardNum; i++)
+                    move.cards << nullptr;
+            } else {
+                foreach (const QVariant &cardData, cards) {
+                    const Card *card = client->m_cardTable.card(cardData.toUInt());
+                    if (card)
+                        move.cards << card;
+                    else
+                        qWarning("Unknown card id received: %u", cardData.toUInt());
+                }
             }
+
+            moves << move;
         }
+    }
 
+    CardMoveTransaction transaction;
+    foreach (const CardsMoveStruct &move, moves) {
         CardArea *source = client->findArea(move.from);
         CardArea *destination = client->findArea(move.to);
-        if (source)
-            source->remove(move.cards);
+        transaction.add(source);
+        transaction.add(destination);
+        if (source) {
+            //Hidden cards leaving the discard pile, which is reshuffled into the draw pile, are its first cards
+            if (source->type() == CardArea::DiscardPile && !move.cards.isEmpty() && move.cards.first() == nullptr)
+                source->takeFirst(move.cards.length());
+            else
+                source->remove(move.cards);
+        }
         if (destination)
             destination->add(move.cards);
-
-        moves << move;
     }
+    transaction.commit();
 
     emit client->cardsMoved(moves);
 }
@@ -264,30 +353,153 @@ void Client::AddCardHistoryCommand(QObject *receiver, const QVariant &data)
 
     if (data.isNull()) {
         self->clearCardHistory();
+    } else if (WireReader::isBinary(data)) {
+        WireReader reader(data);
+        if (!reader.isValid())
+            return;
+        uint nameId = reader.readVarint();
+        int times = reader.readSignedVarint();
+        if (reader.isValid())
+            self->addCardHistory(nameId, times);
     } else {
         QVariantList dataList = data.toList();
         if (dataList.size() != 2)
             return;
 
-        QString name = dataList.at(0).toString();
+        uint nameId = StringPool::cardNames()->find(dataList.at(0).toString());
         int times = dataList.at(1).toInt();
-        self->addCardHistory(name, times);
+        self->addCardHistory(nameId, times);
     }
 }
 
 void Client::DamageCommand(QObject *receiver, const QVariant &data)
 {
-    QVariantList dataList = data.toList();
-    if (dataList.length() != 3)
-        return;
+    uint victimId;
+    DamageStruct::Nature nature;
+    int damage;
+
+    WireReader reader(data);
+    if (reader.isValid()) {
+        victimId = reader.readVarint();
+        nature = static_cast<DamageStruct::Nature>(reader.readByte());
+        damage = reader.readSignedVarint();
+        if (!reader.isValid())
+            return;
+    } else {
+        QVariantList dataList = data.toList();
+        if (dataList.length() != 3)
+            return;
+        victimId = dataList.at(0).toUInt();
+        nature = static_cast<DamageStruct::Nature>(dataList.at(1).toInt());
+        damage = dataList.at(2).toInt();
+    }
 
     Client *client = qobject_cast<Client *>(receiver);
-    ClientPlayer *victim = client->findPlayer(dataList.at(0).toUInt());
-    DamageStruct::Nature nature = static_cast<DamageStruct::Nature>(dataList.at(1).toInt());
-    int damage = dataList.at(2).toInt();
+    ClientPlayer *victim = client->findPlayer(victimId);
     emit client->damageDone(victim, nature, damage);
 }
 
+static QList<const Card *> SnapshotCards(const QVariant &data, const CardTable &table)
+{
+    QList<const Card *> cards;
+    if (data.type() == QVariant::List) {
+        QVariantList cardData = data.toList();
+        foreach (const QVariant &cardId, cardData)
+            cards << table.card(cardId.toUInt());
+    } else {
+        //Only the number of hidden cards is known
+        int cardNum = data.toInt();
+        for (int i = 0; i < cardNum; i++)
+            cards << nullptr;
+    }
+    return cards;
+}
+
+void Client::SyncStateCommand(QObject *receiver, const QVariant &data)
+{
+    const QVariantMap state = data.toMap();
+    if (state.isEmpty())
+        return;
+
+    Client *client = qobject_cast<Client *>(receiver);
+
+    //Everything is rebuilt in one pass. The views are refreshed once at the end.
+    client->restart();
+    PrepareCardsCommand(receiver, state["cards"]);
+    {
+        QSignalBlocker blocker(client);
+        ArrangeSeatCommand(receiver, state["seats"]);
+    }
+
+    static const CardArea::Type areaTypes[] = {CardArea::Hand, CardArea::Equip, CardArea::DelayedTrick, CardArea::Judge};
+    static const char *areaKeys[] = {"handcards", "equips", "delayedTricks", "judgeCards"};
+
+    QList<CardsMoveStruct> moves;
+    CardMoveTransaction transaction;
+    QVariantList playerList = state["players"].toList();
+    foreach (const QVariant &playerData, playerList) {
+        const QVariantMap info = playerData.toMap();
+        ClientPlayer *player = client->findPlayer(info["id"].toUInt());
+        if (player == nullptr)
+            continue;
+
+        //Property signals are coalesced by updateProperty()
+        QVariantList properties = info["properties"].toList();
+        for (int i = 0; i < properties.length() && i < Player::PropertyCount; i++)
+            player->updateProperty(static_cast<Player::Property>(i), properties.at(i));
+
+        for (int i = 0; i < 4; i++) {
+            CardsMoveStruct move;
+            move.from.type = CardArea::DrawPile;
+            move.to.type = areaTypes[i];
+            move.to.owner = player;
+            move.cards = SnapshotCards(info[areaKeys[i]], client->m_cardTable);
+            if (move.cards.isEmpty())
+                continue;
+            move.isOpen = move.cards.first() != nullptr;
+
+            CardArea *area = client->findArea(move.to);
+            transaction.add(area);
+            area->add(move.cards);
+            moves << move;
+        }
+    }
+    transaction.commit();
+
+    ClientPlayer *self = client->m_user2player.value(client->self());
+    if (self) {
+        QVariantList history = state["cardHistory"].toList();
+        for (int nameId = 1; nameId < history.length(); nameId++)
+            self->addCardHistory(nameId, history.at(nameId).toInt());
+    }
+
+    emit client->seatArranged();
+    emit client->cardsMoved(moves);
+
+    //The state doubles as the protocol negotiation of the new connection. The server asks again for its pending request afterwards.
+    client->replyToServer(S_COMMAND_SYNC_STATE, static_cast<int>(WireWriter::Version));
+}
+
+void Client::NegotiateProtocolCommand(QObject *receiver, const QVariant &)
+{
+    //Binary payloads of another version couldn't be decoded, so the server falls back to JSON maps unless it has the same version
+    Client *client = qobject_cast<Client *>(receiver);
+    client->replyToServer(S_COMMAND_NEGOTIATE_PROTOCOL, static_cast<int>(WireWriter::Version));
+}
+
+void Client::ReconnectTokenCommand(QObject *receiver, const QVariant &data)
+{
+    Client *client = qobject_cast<Client *>(receiver);
+    client->m_reconnectToken = data.toString();
+}
+
+void Client::ReconnectCommand(QObject *receiver, const QVariant &)
+{
+    //The server gives the seat back only to the client that was sent its token
+    Client *client = qobject_cast<Client *>(receiver);
+    client->replyToServer(S_COMMAND_RECONNECT, client->m_reconnectToken);
+}
+
 static QObject *ClientInstanceCallback(QQmlEngine *, QJSEngine *)
 {
     return Client::instance();
@@ -303,8 +515,12 @@ void Client::Init()
     AddCallback(S_COMMAND_MOVE_CARDS, MoveCardsCommand);
     AddCallback(S_COMMAND_ADD_CARD_HISTORY, AddCardHistoryCommand);
     AddCallback(S_COMMAND_DAMAGE, DamageCommand);
+    AddCallback(S_COMMAND_RECONNECT_TOKEN, ReconnectTokenCommand);
 
     AddInteraction(S_COMMAND_CHOOSE_GENERAL, ChooseGeneralCommand);
     AddInteraction(S_COMMAND_USE_CARD, UseCardCommand);
+    AddInteraction(S_COMMAND_NEGOTIATE_PROTOCOL, NegotiateProtocolCommand);
+    AddInteraction(S_COMMAND_SYNC_STATE, SyncStateCommand);
+    AddInteraction(S_COMMAND_RECONNECT, ReconnectCommand);
 }
 C_INITIALIZE_CLASS(Client)
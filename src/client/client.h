@@ -24,10 +24,13 @@
 
 #include <QMap>
 
+#include "cardtable.h"
+#include "playerring.h"
 #include "structs.h"
 
 class Card;
 class ClientPlayer;
+class WireReader;
 
 class Client : public CClient
 {
@@ -41,7 +44,7 @@ public:
     QList<const ClientPlayer *> players() const;
     int playerNum() const;
 
-    const Card *findCard(uint id) { return m_cards.value(id); }
+    const Card *findCard(uint id) { return m_cardTable.card(id); }
     void useCard(const Card *card, const QList<const ClientPlayer *> &targets);
 
 signals:
@@ -57,6 +60,7 @@ private:
     void restart();
     ClientPlayer *findPlayer(uint id) { return m_players.value(id); }
     CardArea *findArea(const CardsMoveStruct::Area &area);
+    void readArea(WireReader &reader, CardsMoveStruct::Area &area);
 
     C_DECLARE_INITIALIZER(Client)
     static void ArrangeSeatCommand(QObject *receiver, const QVariant &data);
@@ -67,10 +71,17 @@ private:
     static void UseCardCommand(QObject *receiver, const QVariant &data);
     static void AddCardHistoryCommand(QObject *receiver, const QVariant &data);
     static void DamageCommand(QObject *receiver, const QVariant &data);
+    static void SyncStateCommand(QObject *receiver, const QVariant &data);
+    static void NegotiateProtocolCommand(QObject *receiver, const QVariant &data);
+    static void ReconnectTokenCommand(QObject *receiver, const QVariant &data);
+    static void ReconnectCommand(QObject *receiver, const QVariant &data);
 
     QMap<uint, ClientPlayer *> m_players;
     QMap<CClientUser *, ClientPlayer *> m_user2player;
-    QMap<uint, Card *> m_cards;//Record card state
+    PlayerRing m_ring;
+    CardTable m_cardTable;//Record card state
+    //Kept across restart() so that the seat can be taken back after a reconnection
+    QString m_reconnectToken;
 };
 
 #endif // CLIENT_H
@@ -1,7 +1,62 @@
 #include "clientplayer.h"
 
+#include <QSignalBlocker>
+
+struct PropertySetter
+{
+    void (*set)(Player *player, const QVariant &value);
+    void (Player::*notify)();
+};
+
+//Indexed by Player::Property
+static const PropertySetter PropertySetters[Player::PropertyCount] = {
+    {[](Player *player, const QVariant &value){ player->setScreenName(value.toString()); }, &Player::screenNameChanged},
+    {[](Player *player, const QVariant &value){ player->setHp(value.toInt()); }, &Player::hpChanged},
+    {[](Player *player, const QVariant &value){ player->setMaxHp(value.toInt()); }, &Player::maxHpChanged},
+    {[](Player *player, const QVariant &value){ player->setAlive(value.toBool()); }, &Player::aliveChanged},
+    {[](Player *player, const QVariant &value){ player->setRemoved(value.toBool()); }, &Player::removedChanged},
+    {[](Player *player, const QVariant &value){ player->setSeat(value.toInt()); }, &Player::seatChanged},
+    {[](Player *player, const QVariant &value){ player->setPhaseString(value.toString()); }, &Player::phaseChanged},
+    {[](Player *player, const QVariant &value){ player->setHeadGeneralName(value.toString()); }, &Player::headGeneralChanged},
+    {[](Player *player, const QVariant &value){ player->setDeputyGeneralName(value.toString()); }, &Player::deputyGeneralChanged},
+    {[](Player *player, const QVariant &value){ player->setTurnCount(value.toInt()); }, nullptr},
+    {[](Player *player, const QVariant &value){ player->setFaceUp(value.toBool()); }, &Player::faceUpChanged},
+    {[](Player *player, const QVariant &value){ player->setDrank(value.toInt()); }, &Player::drankChanged},
+    {[](Player *player, const QVariant &value){ player->setKingdom(value.toString()); }, &Player::kingdomChanged},
+    {[](Player *player, const QVariant &value){ player->setRole(value.toString()); }, &Player::roleChanged}
+};
+
 ClientPlayer::ClientPlayer(CClientUser *user, QObject *parent)
     : Player(parent)
     , m_user(user)
+    , m_changedProperties(0)
+{
+}
+
+void ClientPlayer::updateProperty(Property property, const QVariant &value)
+{
+    if (property < 0 || property >= PropertyCount)
+        return;
+
+    const PropertySetter &setter = PropertySetters[property];
+    {
+        QSignalBlocker blocker(this);
+        (*setter.set)(this, value);
+    }
+
+    if (setter.notify) {
+        if (m_changedProperties == 0)
+            QMetaObject::invokeMethod(this, "emitPropertyChanges", Qt::QueuedConnection);
+        m_changedProperties |= 1u << property;
+    }
+}
+
+void ClientPlayer::emitPropertyChanges()
 {
+    quint32 changed = m_changedProperties;
+    m_changedProperties = 0;
+    for (int i = 0; i < PropertyCount; i++) {
+        if (changed & (1u << i))
+            emit (this->*PropertySetters[i].notify)();
+    }
 }
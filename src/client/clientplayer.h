@@ -35,8 +35,16 @@ public:
 
     CClientUser *user() const { return m_user; }
 
+    //Applies a property sent by the server. The NOTIFY signals are emitted once per property
+    //when control returns to the event loop, so that all updates of a network read are merged.
+    void updateProperty(Property property, const QVariant &value);
+
+private slots:
+    void emitPropertyChanges();
+
 private:
     CClientUser *m_user;
+    quint32 m_changedProperties;
 };
 
 #endif // CLIENTPLAYER_H
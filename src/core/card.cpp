@@ -21,9 +21,11 @@
 #include "eventtype.h"
 #include "gamelogic.h"
 #include "serverplayer.h"
+#include "stringpool.h"
 
 Card::Card(Suit suit, int number)
-    : m_suit(suit)
+    : m_nameId(0)
+    , m_suit(suit)
     , m_number(number)
     , m_color(NoColor)
     , m_transferable(false)
@@ -40,12 +42,16 @@ Card::Card(Suit suit, int number)
     }
 }
 
-Card *Card::clone() const
+void Card::setObjectName(const QString &name)
 {
-    const QMetaObject *metaObject = this->metaObject();
-    Card *card = qobject_cast<Card *>(metaObject->newInstance(Q_ARG(Suit, suit()), Q_ARG(int, number())));
-    card->m_id = m_id;
-    return card;
+    QObject::setObjectName(name);
+
+    //Cards of packages are named before any name is interned. Virtual cards of skills are named at run time,
+    //but only with names the packages have. Interning a new name here would give it an id that other processes don't know.
+    StringPool *cardNames = StringPool::cardNames();
+    m_nameId = cardNames->find(name);
+    if (m_nameId == 0 && cardNames->size() > 0)
+        qWarning("Card name %s is not registered by any package", qPrintable(name));
 }
 
 uint Card::effectiveId() const
@@ -147,22 +153,11 @@ QString Card::typeString() const
         return "skill";
 }
 
-void Card::addSubcard(Card *card)
+void Card::addSubcard(const Card *card)
 {
     m_subcards << card;
 }
 
-Card *Card::realCard()
-{
-    if (id() > 0)
-        return this;
-
-    if (m_subcards.length() == 1)
-        return m_subcards.first()->realCard();
-
-    return nullptr;
-}
-
 const Card *Card::realCard() const
 {
     if (id() > 0)
@@ -174,18 +169,6 @@ const Card *Card::realCard() const
     return nullptr;
 }
 
-QList<Card *> Card::realCards()
-{
-    QList<Card *> cards;
-    if (id() > 0) {
-        cards << this;
-    } else {
-        foreach (Card *card, m_subcards)
-            cards << card->realCards();
-    }
-    return cards;
-}
-
 QList<const Card *> Card::realCards() const
 {
     QList<const Card *> cards;
@@ -219,12 +202,11 @@ bool Card::isAvailable(const Player *player) const
     return false;
 }
 
-void Card::onUse(GameLogic *logic, CardUseStruct &use)
+void Card::onUse(GameLogic *logic, CardUseStruct &use) const
 {
     logic->sortByActionOrder(use.to);
 
-    QVariant useData = QVariant::fromValue(&use);
-    logic->trigger(PreCardUsed, use.from, useData);
+    logic->trigger<PreCardUsed>(use.from, use);
 
     CardsMoveStruct move;
     move.to.type = CardArea::Table;
@@ -233,16 +215,22 @@ void Card::onUse(GameLogic *logic, CardUseStruct &use)
     logic->moveCards(move);
 }
 
-void Card::use(GameLogic *logic, ServerPlayer *source, QList<ServerPlayer *> &targets)
+void Card::use(GameLogic *logic, ServerPlayer *source, QList<ServerPlayer *> &targets) const
 {
+    int drank = 0;
     foreach (ServerPlayer *target, targets) {
+        if (logic->isInterrupted())
+            break;
+
         CardEffectStruct effect;
         effect.card = this;
         effect.from = source;
         effect.to = target;
         effect.multiple = (targets.length() > 1);
+        effect.drank = drank;
         //@to-do: effect.nullified = ?
         logic->takeCardEffect(effect);
+        drank = effect.drank;
     }
 
     const CardArea *table = logic->table();
@@ -255,7 +243,7 @@ void Card::use(GameLogic *logic, ServerPlayer *source, QList<ServerPlayer *> &ta
     }
 }
 
-void Card::onEffect(GameLogic*, CardEffectStruct &)
+void Card::onEffect(GameLogic*, CardEffectStruct &) const
 {
 }
 
@@ -294,17 +282,16 @@ EquipCard::EquipCard(Card::Suit suit, int number, Skill *skill)
     m_type = EquipType;
 }
 
-void EquipCard::onUse(GameLogic *logic, CardUseStruct &use)
+void EquipCard::onUse(GameLogic *logic, CardUseStruct &use) const
 {
     ServerPlayer *player = use.from;
     if (use.to.isEmpty())
         use.to << player;
 
-    QVariant data = QVariant::fromValue(&use);
-    logic->trigger(PreCardUsed, player, data);
+    logic->trigger<PreCardUsed>(player, use);
 }
 
-void EquipCard::use(GameLogic *logic, ServerPlayer *, QList<ServerPlayer *> &targets)
+void EquipCard::use(GameLogic *logic, ServerPlayer *, QList<ServerPlayer *> &targets) const
 {
     if (targets.isEmpty()) {
         CardsMoveStruct move;
@@ -318,9 +305,9 @@ void EquipCard::use(GameLogic *logic, ServerPlayer *, QList<ServerPlayer *> &tar
     ServerPlayer *target = targets.first();
 
     //Find the existing equip
-    Card *equippedCard = nullptr;
-    QList<Card *> equips = target->equips()->cards();
-    foreach (Card *card, equips) {
+    const Card *equippedCard = nullptr;
+    QList<const Card *> equips = target->equips()->cards();
+    foreach (const Card *card, equips) {
         if (card->subtype() == subtype()) {
             equippedCard = card;
             break;
@@ -364,7 +351,7 @@ GlobalEffect::GlobalEffect(Card::Suit suit, int number)
     m_subtype = GlobalEffectType;
 }
 
-void GlobalEffect::onUse(GameLogic *logic, CardUseStruct &use)
+void GlobalEffect::onUse(GameLogic *logic, CardUseStruct &use) const
 {
     if (use.to.isEmpty())
         use.to = logic->otherPlayers(use.from);
@@ -378,7 +365,7 @@ AreaOfEffect::AreaOfEffect(Card::Suit suit, int number)
     m_subtype = AreaOfEffectType;
 }
 
-void AreaOfEffect::onUse(GameLogic *logic, CardUseStruct &use)
+void AreaOfEffect::onUse(GameLogic *logic, CardUseStruct &use) const
 {
     if (use.to.isEmpty())
         use.to = logic->otherPlayers(use.from);
@@ -403,12 +390,11 @@ DelayedTrick::DelayedTrick(Card::Suit suit, int number)
     m_subtype = DelayedType;
 }
 
-void DelayedTrick::onUse(GameLogic *logic, CardUseStruct &use)
+void DelayedTrick::onUse(GameLogic *logic, CardUseStruct &use) const
 {
     use.card = this;
 
-    QVariant data = QVariant::fromValue(&use);
-    logic->trigger(PreCardUsed, use.from, data);
+    logic->trigger<PreCardUsed>(use.from, use);
 
     CardsMoveStruct move;
     move.cards = use.card->realCards();
@@ -22,7 +22,6 @@
 
 #include <QObject>
 #include <QList>
-#include <QSet>
 
 class GameLogic;
 class Player;
@@ -38,12 +37,12 @@ class Card : public QObject
 
     Q_PROPERTY(uint id READ id)
     Q_PROPERTY(uint effectiveId READ effectiveId)
-    Q_PROPERTY(QString suit READ suitString WRITE setSuitString)
-    Q_PROPERTY(int number READ number WRITE setNumber)
-    Q_PROPERTY(QString color READ colorString WRITE setColorString)
+    Q_PROPERTY(QString suit READ suitString)
+    Q_PROPERTY(int number READ number)
+    Q_PROPERTY(QString color READ colorString)
     Q_PROPERTY(QString type READ typeString)
-    Q_PROPERTY(bool transferable READ isTransferable WRITE setTransferable)
-    Q_PROPERTY(QString skillName READ skillName WRITE setSkillName)
+    Q_PROPERTY(bool transferable READ isTransferable)
+    Q_PROPERTY(QString skillName READ skillName)
 
 public:
     enum Suit
@@ -72,13 +71,22 @@ public:
         EquipType
     };
 
+    //Cards of packages are shared by all the rooms and only accessed through const pointers once they are loaded.
+    //The setters are meant for virtual cards, which are built for one use.
     Q_INVOKABLE Card(Suit suit = NoSuit, int number = 0);
-    Card *clone() const;
 
     uint id() const { return m_id; }
     bool isVirtual() const { return id() == 0; }
     uint effectiveId() const;
 
+    //Id of objectName() in StringPool::cardNames(), 0 if no package has a card of the name.
+    //Cards of packages get it once the packages are loaded, see Engine::internNames(). Virtual cards get it when they are named.
+    uint nameId() const { return m_nameId; }
+    void setNameId(uint id) { m_nameId = id; }
+
+    //Hides QObject::setObjectName() to look up nameId() once instead of on every use
+    void setObjectName(const QString &name);
+
     void setSuit(Suit suit) { m_suit = suit; }
     Suit suit() const;
     void setSuitString(const QString &suit);
@@ -97,12 +105,10 @@ public:
     int subtype() const { return m_subtype; }
     QString typeString() const;
 
-    void addSubcard(Card *card);
-    QList<Card *> subcards() const { return m_subcards; }
+    void addSubcard(const Card *card);
+    QList<const Card *> subcards() const { return m_subcards; }
 
-    Card *realCard();
     const Card *realCard() const;
-    QList<Card *> realCards();
     QList<const Card *> realCards() const;
 
     void setTransferable(bool transferable) { m_transferable = transferable; }
@@ -111,11 +117,6 @@ public:
     void setSkillName(const QString &name) { m_skillName = name; }
     QString skillName() const { return m_skillName; }
 
-    void addFlag(const QString &flag) { m_flags.insert(flag); }
-    void removeFlag(const QString &flag) { m_flags.remove(flag); }
-    bool hasFlag(const QString &flag) const { return m_flags.contains(flag); }
-    void clearFlags() { m_flags.clear(); }
-
     bool willThrow() const { return m_willThrow; }
     bool canRecast() const { return m_canRecast; }
 
@@ -124,15 +125,17 @@ public:
     virtual bool targetFilter(const QList<const Player *> &targets, const Player *toSelect, const Player *self) const;
     virtual bool isAvailable(const Player *player) const;
 
-    virtual void onUse(GameLogic *logic, CardUseStruct &use);
-    virtual void use(GameLogic *logic, ServerPlayer *source, QList<ServerPlayer *> &targets);
-    virtual void onEffect(GameLogic *logic, CardEffectStruct &effect);
+    //State of a use is kept in CardUseStruct and CardEffectStruct, never in the card
+    virtual void onUse(GameLogic *logic, CardUseStruct &use) const;
+    virtual void use(GameLogic *logic, ServerPlayer *source, QList<ServerPlayer *> &targets) const;
+    virtual void onEffect(GameLogic *logic, CardEffectStruct &effect) const;
 
     virtual bool isCancelable(const CardEffectStruct &effect) const;
     virtual void onNullified(ServerPlayer *target) const;
 
 protected:
     uint m_id;
+    uint m_nameId;
     Suit m_suit;
     int m_number;
     Color m_color;
@@ -145,8 +148,7 @@ protected:
     bool m_targetFixed;
 
     QString m_skillName;
-    QList<Card *> m_subcards;
-    QSet<QString> m_flags;
+    QList<const Card *> m_subcards;
 };
 
 class Skill;
@@ -200,8 +202,8 @@ public:
 
     EquipCard(Suit suit, int number, Skill *skill = nullptr);
 
-    void onUse(GameLogic *logic, CardUseStruct &card_use) override;
-    void use(GameLogic *logic, ServerPlayer *, QList<ServerPlayer *> &targets) override;
+    void onUse(GameLogic *logic, CardUseStruct &card_use) const override;
+    void use(GameLogic *logic, ServerPlayer *, QList<ServerPlayer *> &targets) const override;
 
 protected:
     Skill *m_skill;
@@ -214,7 +216,7 @@ class GlobalEffect : public TrickCard
 public:
     GlobalEffect(Card::Suit suit, int number);
 
-    void onUse(GameLogic *logic, CardUseStruct &use) override;
+    void onUse(GameLogic *logic, CardUseStruct &use) const override;
 };
 
 class AreaOfEffect : public TrickCard
@@ -224,7 +226,7 @@ class AreaOfEffect : public TrickCard
 public:
     AreaOfEffect(Suit suit, int number);
 
-    void onUse(GameLogic *logic, CardUseStruct &use) override;
+    void onUse(GameLogic *logic, CardUseStruct &use) const override;
 };
 
 class SingleTargetTrick : public TrickCard
@@ -244,7 +246,7 @@ class DelayedTrick : public TrickCard
 public:
     DelayedTrick(Suit suit, int number);
 
-    void onUse(GameLogic *logic, CardUseStruct &use) override;
+    void onUse(GameLogic *logic, CardUseStruct &use) const override;
 
 protected:
     bool m_movable;
@@ -18,85 +18,266 @@
 *********************************************************************/
 
 #include "cardarea.h"
+#include "cardtable.h"
 
 CardArea::CardArea(CardArea::Type type, Player *owner, const QString &name)
     : m_type(type)
     , m_owner(owner)
     , m_name(name)
+    , m_changeDepth(0)
+    , m_changed(false)
+    , m_cardTable(nullptr)
+    , m_offset(0)
 {
 }
 
-bool CardArea::add(Card *card, Direction direction) {
-    if (m_cards.contains(card))
+bool CardArea::add(const Card *card, Direction direction) {
+    //Hidden cards are nullptr, each of which stands for one card
+    if (card && contains(card))
         return false;
-    if (direction == Bottom)
+    if (direction == Bottom) {
         m_cards.prepend(card);
-    else
+        m_offset--;
+        updateIndex(0, 1);
+    } else {
         m_cards.append(card);
-    if (m_changeSignal)
-        m_changeSignal();
+        updateIndex(m_cards.length() - 1);
+    }
+    notifyChange();
     return true;
 }
 
-bool CardArea::add(const QList<Card *> &cards, Direction direction)
+bool CardArea::add(const QList<const Card *> &cards, Direction direction)
 {
     int num = length();
-    foreach (Card *card, cards) {
-        if (m_cards.contains(card))
+    foreach (const Card *card, cards) {
+        //Each card is indexed at once, so that a duplicate later in the batch is found
+        if (card && contains(card))
             continue;
-        if (direction == Bottom)
+        if (direction == Bottom) {
             m_cards.prepend(card);
-        else
+            m_offset--;
+            updateIndex(0, 1);
+        } else {
             m_cards.append(card);
+            updateIndex(m_cards.length() - 1);
+        }
     }
 
-    if (m_changeSignal && num != length())
-            m_changeSignal();
+    if (num != length())
+        notifyChange();
 
     return num + cards.length() == length();
 }
 
-bool CardArea::remove(Card *card)
+void CardArea::endChange()
 {
-    if (m_cards.removeOne(card)) {
-        if (m_changeSignal)
-            m_changeSignal();
+    m_changeDepth--;
+    if (m_changeDepth <= 0) {
+        m_changeDepth = 0;
+        if (m_changed) {
+            m_changed = false;
+            if (m_changeSignal)
+                m_changeSignal();
+        }
+    }
+}
+
+bool CardArea::isOrdered() const
+{
+    switch (m_type) {
+    case Hand:
+    case Equip:
+    case Table:
+    case Special:
+        return false;
+    default:
         return true;
     }
+}
+
+bool CardArea::remove(const Card *card)
+{
+    int index = indexOf(card);
+    if (index < 0)
+        return false;
+
+    removeAt(index);
 
-    return false;
+    notifyChange();
+    return true;
 }
 
-bool CardArea::remove(const QList<Card *> &cards)
+bool CardArea::remove(const QList<const Card *> &cards)
 {
     int num = length();
-    foreach (Card *card, cards)
-        m_cards.removeOne(card);
+    if (m_cardTable == nullptr || !isOrdered()) {
+        foreach (const Card *card, cards) {
+            int index = indexOf(card);
+            if (index >= 0)
+                removeAt(index);
+        }
+    } else {
+        //Cards unknown to the table, such as hidden cards, shift the others
+        foreach (const Card *card, cards) {
+            if (m_cardTable->entry(card) == nullptr) {
+                int index = m_cards.indexOf(card);
+                if (index >= 0)
+                    removeAt(index);
+            }
+        }
 
-    if (m_changeSignal && num != length())
-            m_changeSignal();
+        int removed = 0;
+        int first = m_cards.length();
+        int last = -1;
+        foreach (const Card *card, cards) {
+            int index = indexOf(card);
+            if (index < 0 || m_cardTable->entry(card) == nullptr)
+                continue;
+            detach(card);
+            removed++;
+            first = qMin(first, index);
+            last = qMax(last, index);
+        }
+
+        if (removed > 0 && last - first + 1 == removed) {
+            //A contiguous range such as the top cards of the draw pile
+            m_cards.erase(m_cards.begin() + first, m_cards.begin() + last + 1);
+            if (first == 0)
+                m_offset += removed;
+            else
+                updateIndex(first);
+        } else if (removed > 0) {
+            int j = 0;
+            for (int i = 0; i < m_cards.length(); i++) {
+                const Card *card = m_cards.at(i);
+                CardTable::Entry *entry = m_cardTable->entry(card);
+                if (entry && entry->area != this)
+                    continue;
+                if (entry)
+                    entry->index = j + m_offset;
+                m_cards[j++] = card;
+            }
+            m_cards.erase(m_cards.begin() + j, m_cards.end());
+        }
+    }
+
+    if (num != length())
+        notifyChange();
 
     return num - cards.length() == length();
 }
 
-QList<Card *> CardArea::takeFirst(int n)
+const Card *CardArea::takeFirst()
+{
+    const Card *card = m_cards.takeFirst();
+    detach(card);
+    m_offset++;
+    return card;
+}
+
+const Card *CardArea::takeLast()
 {
-    QList<Card *> cards = m_cards.mid(0, n);
-    m_cards = m_cards.mid(n + 1);
+    const Card *card = m_cards.takeLast();
+    detach(card);
+    return card;
+}
+
+QList<const Card *> CardArea::takeFirst(int n)
+{
+    QList<const Card *> cards = m_cards.mid(0, n);
+    m_cards.erase(m_cards.begin(), m_cards.begin() + cards.length());
+    foreach (const Card *card, cards)
+        detach(card);
+    m_offset += cards.length();
     return cards;
 }
 
-QList<Card *> CardArea::takeLast(int n)
+QList<const Card *> CardArea::takeLast(int n)
 {
-    QList<Card *> cards = m_cards.mid(length() - n);
-    m_cards = m_cards.mid(0, length() - n);
+    QList<const Card *> cards = m_cards.mid(length() - n);
+    m_cards.erase(m_cards.end() - cards.length(), m_cards.end());
+    foreach (const Card *card, cards)
+        detach(card);
     return cards;
 }
 
 bool CardArea::contains(const Card *card) const
 {
-    foreach (const Card *c, m_cards)
-        if (c == card)
-            return true;
-    return false;
+    return indexOf(card) >= 0;
+}
+
+int CardArea::indexOf(const Card *card) const
+{
+    const CardTable::Entry *entry = m_cardTable ? m_cardTable->entry(card) : nullptr;
+    if (entry)
+        return entry->area == this ? entry->index - m_offset : -1;
+    return m_cards.indexOf(card);
+}
+
+void CardArea::notifyChange()
+{
+    if (m_changeDepth > 0)
+        m_changed = true;
+    else if (m_changeSignal)
+        m_changeSignal();
+}
+
+void CardArea::removeAt(int index)
+{
+    const Card *card = m_cards.at(index);
+    detach(card);
+
+    if (index == 0) {
+        m_cards.removeFirst();
+        m_offset++;
+    } else if (isOrdered()) {
+        m_cards.removeAt(index);
+        updateIndex(index);
+    } else {
+        m_cards[index] = m_cards.last();
+        m_cards.removeLast();
+        if (index < m_cards.length())
+            updateIndex(index, index + 1);
+    }
+}
+
+void CardArea::updateIndex(int from, int to)
+{
+    if (m_cardTable == nullptr)
+        return;
+
+    if (to < 0 || to > m_cards.length())
+        to = m_cards.length();
+    for (int i = from; i < to; i++) {
+        CardTable::Entry *entry = m_cardTable->entry(m_cards.at(i));
+        if (entry) {
+            entry->area = this;
+            entry->index = i + m_offset;
+        }
+    }
+}
+
+void CardArea::detach(const Card *card)
+{
+    CardTable::Entry *entry = m_cardTable ? m_cardTable->entry(card) : nullptr;
+    if (entry && entry->area == this) {
+        entry->area = nullptr;
+        entry->index = -1;
+    }
+}
+
+void CardMoveTransaction::add(CardArea *area)
+{
+    if (area == nullptr || m_areas.contains(area))
+        return;
+    area->beginChange();
+    m_areas.append(area);
+}
+
+void CardMoveTransaction::commit()
+{
+    foreach (CardArea *area, m_areas)
+        area->endChange();
+    m_areas.clear();
 }
@@ -21,10 +21,12 @@
 #define CARDAREA_H
 
 #include <QList>
+#include <QVarLengthArray>
 #include <functional>
 
 class Player;
 class Card;
+class CardTable;
 
 class CardArea
 {
@@ -48,42 +50,78 @@ public:
 
     CardArea(Type type, Player *owner = nullptr, const QString &name = QString());
     Type type() const { return m_type; }
+    //Whether removing a card must keep the order of the others. Unordered areas swap the last card into the gap.
+    bool isOrdered() const;
     Player *owner() const { return m_owner; }
     QString name() const { return m_name; }
 
     void setSignal(ChangeSignal signal) { m_changeSignal = signal; }
+    //The signal is deferred until the last endChange(), then emitted once if the cards changed
+    void beginChange() { m_changeDepth++; }
+    void endChange();
 
-    bool add(Card *card, Direction direction = UndefinedDirection);
-    bool add(const QList<Card *> &cards, Direction direction = UndefinedDirection);
-    bool remove(Card *card);
-    bool remove(const QList<Card *> &cards);
+    //Once set, the table records the position of every card in the area
+    void setCardTable(CardTable *table) { m_cardTable = table; }
+    CardTable *cardTable() const { return m_cardTable; }
 
-    Card *first() const { return m_cards.first(); }
-    Card *takeFirst() { return m_cards.takeFirst(); }
+    bool add(const Card *card, Direction direction = UndefinedDirection);
+    bool add(const QList<const Card *> &cards, Direction direction = UndefinedDirection);
+    bool remove(const Card *card);
+    bool remove(const QList<const Card *> &cards);
 
-    Card *last() const { return m_cards.last(); }
-    Card *takeLast() { return m_cards.takeLast(); }
+    const Card *first() const { return m_cards.first(); }
+    const Card *takeFirst();
 
-    QList<Card *> first(int n) const { return m_cards.mid(0, n); }
-    QList<Card *> takeFirst(int n);
+    const Card *last() const { return m_cards.last(); }
+    const Card *takeLast();
 
-    QList<Card *> last(int n) const { return m_cards.mid(m_cards.length() - n); }
-    QList<Card *> takeLast(int n);
+    QList<const Card *> first(int n) const { return m_cards.mid(0, n); }
+    QList<const Card *> takeFirst(int n);
+
+    QList<const Card *> last(int n) const { return m_cards.mid(m_cards.length() - n); }
+    QList<const Card *> takeLast(int n);
 
     bool contains(const Card *card) const;
+    int indexOf(const Card *card) const;
 
-    QList<Card *> &cards() { return m_cards; }
-    QList<Card *> cards() const { return m_cards; }
+    QList<const Card *> &cards() { return m_cards; }
+    QList<const Card *> cards() const { return m_cards; }
 
     int length() const { return m_cards.length(); }
     int size() const { return m_cards.size(); }
 
 private:
+    void notifyChange();
+    void removeAt(int index);
+    void updateIndex(int from, int to = -1);
+    void detach(const Card *card);
+
     Type m_type;
     Player *m_owner;
     QString m_name;
-    QList<Card *> m_cards;
+    QList<const Card *> m_cards;
     ChangeSignal m_changeSignal;
+    int m_changeDepth;
+    bool m_changed;
+    CardTable *m_cardTable;
+    //Slot of the first card, so that taking or putting cards on the top doesn't renumber the others
+    int m_offset;
+};
+
+//Coalesces the change signals of the areas touched by card moves into one per area
+class CardMoveTransaction
+{
+public:
+    CardMoveTransaction() {}
+    ~CardMoveTransaction() { commit(); }
+
+    void add(CardArea *area);
+    void commit();
+
+private:
+    Q_DISABLE_COPY(CardMoveTransaction)
+
+    QVarLengthArray<CardArea *, 8> m_areas;
 };
 
 #endif // CARDAREA_H
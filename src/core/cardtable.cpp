@@ -0,0 +1,62 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+#include "card.h"
+#include "cardtable.h"
+
+void CardTable::add(const Card *card)
+{
+    uint id = card->id();
+    if (id >= uint(m_entries.size()))
+        m_entries.resize(id + 1);
+    m_entries[id].card = card;
+}
+
+QList<const Card *> CardTable::cards() const
+{
+    QList<const Card *> cards;
+    cards.reserve(m_entries.size());
+    foreach (const Entry &entry, m_entries) {
+        if (entry.card)
+            cards << entry.card;
+    }
+    return cards;
+}
+
+CardTable::Entry *CardTable::entry(const Card *card)
+{
+    if (card == nullptr || card->id() >= uint(m_entries.size()))
+        return nullptr;
+    Entry &entry = m_entries[card->id()];
+    return entry.card == card ? &entry : nullptr;
+}
+
+const CardTable::Entry *CardTable::entry(const Card *card) const
+{
+    if (card == nullptr || card->id() >= uint(m_entries.size()))
+        return nullptr;
+    const Entry &entry = m_entries.at(card->id());
+    return entry.card == card ? &entry : nullptr;
+}
+
+CardArea *CardTable::area(const Card *card) const
+{
+    const Entry *entry = this->entry(card);
+    return entry ? entry->area : nullptr;
+}
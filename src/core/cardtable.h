@@ -0,0 +1,60 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+#ifndef CARDTABLE_H
+#define CARDTABLE_H
+
+#include <QList>
+#include <QVector>
+
+class Card;
+class CardArea;
+
+//Cards of a room indexed by their ids, with the state each card has in the room.
+//The cards are the definitions loaded by Engine, shared by all the rooms and only held through const pointers.
+class CardTable
+{
+public:
+    struct Entry
+    {
+        Entry() : card(nullptr), area(nullptr), index(-1) {}
+
+        const Card *card;
+        CardArea *area;
+        //Position of the card in its area, maintained by CardArea
+        int index;
+    };
+
+    void add(const Card *card);
+    void clear() { m_entries.clear(); }
+
+    const Card *card(uint id) const { return id < uint(m_entries.size()) ? m_entries.at(id).card : nullptr; }
+    QList<const Card *> cards() const;
+
+    //Returns nullptr if the card doesn't belong to this table
+    Entry *entry(const Card *card);
+    const Entry *entry(const Card *card) const;
+
+    CardArea *area(const Card *card) const;
+
+private:
+    QVector<Entry> m_entries;
+};
+
+#endif // CARDTABLE_H
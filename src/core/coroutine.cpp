@@ -0,0 +1,160 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+
+#include "coroutine.h"
+
+#if defined(QSGS_COROUTINE_FIBER)
+#include <windows.h>
+#elif defined(QSGS_COROUTINE_UCONTEXT)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(QSGS_COROUTINE_FIBER)
+
+Coroutine::Coroutine(const Function &func, int stackSize)
+    : m_func(func)
+    , m_finished(false)
+    , m_callerFiber(nullptr)
+{
+    m_fiber = CreateFiber(stackSize, &Coroutine::FiberEntry, this);
+}
+
+Coroutine::~Coroutine()
+{
+    if (m_fiber)
+        DeleteFiber(m_fiber);
+}
+
+void Coroutine::resume()
+{
+    Q_ASSERT(!m_finished);
+    if (!IsThreadAFiber())
+        ConvertThreadToFiber(nullptr);
+
+    m_callerFiber = GetCurrentFiber();
+    SwitchToFiber(m_fiber);
+}
+
+void Coroutine::yield()
+{
+    SwitchToFiber(m_callerFiber);
+}
+
+void __stdcall Coroutine::FiberEntry(void *param)
+{
+    Coroutine *self = static_cast<Coroutine *>(param);
+    self->exec();
+    //A fiber must not return
+    SwitchToFiber(self->m_callerFiber);
+}
+
+bool Coroutine::isSupported()
+{
+    return true;
+}
+
+#elif defined(QSGS_COROUTINE_UCONTEXT)
+
+Coroutine::Coroutine(const Function &func, int stackSize)
+    : m_func(func)
+    , m_finished(false)
+{
+    //Stacks grow downwards, so a PROT_NONE page below the stack makes an overflow fault instead of corrupting other memory
+    size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+    m_stackSize = (size_t(stackSize) + pageSize - 1) / pageSize * pageSize + pageSize;
+    void *stack = mmap(nullptr, m_stackSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (stack == MAP_FAILED)
+        qFatal("Failed to map a coroutine stack of %d bytes", stackSize);
+    m_stack = static_cast<char *>(stack);
+    mprotect(m_stack, pageSize, PROT_NONE);
+
+    getcontext(&m_context);
+    m_context.uc_stack.ss_sp = m_stack + pageSize;
+    m_context.uc_stack.ss_size = m_stackSize - pageSize;
+    m_context.uc_link = &m_callerContext;
+
+    //makecontext() only passes int arguments
+    quintptr self = reinterpret_cast<quintptr>(this);
+    makecontext(&m_context, reinterpret_cast<void (*)()>(&Coroutine::ContextEntry), 2, int(quint64(self) >> 32), int(self & 0xFFFFFFFF));
+}
+
+Coroutine::~Coroutine()
+{
+    munmap(m_stack, m_stackSize);
+}
+
+void Coroutine::resume()
+{
+    Q_ASSERT(!m_finished);
+    swapcontext(&m_callerContext, &m_context);
+}
+
+void Coroutine::yield()
+{
+    swapcontext(&m_context, &m_callerContext);
+}
+
+void Coroutine::ContextEntry(int high, int low)
+{
+    quintptr self = quintptr((quint64(uint(high)) << 32) | uint(low));
+    reinterpret_cast<Coroutine *>(self)->exec();
+    //Returning switches to uc_link, the context of the last resume()
+}
+
+bool Coroutine::isSupported()
+{
+    return true;
+}
+
+#else
+
+//Without a backend the function simply runs to completion in resume()
+Coroutine::Coroutine(const Function &func, int)
+    : m_func(func)
+    , m_finished(false)
+{
+}
+
+Coroutine::~Coroutine()
+{
+}
+
+void Coroutine::resume()
+{
+    exec();
+}
+
+void Coroutine::yield()
+{
+}
+
+bool Coroutine::isSupported()
+{
+    return false;
+}
+
+#endif
+
+void Coroutine::exec()
+{
+    m_func();
+    m_finished = true;
+}
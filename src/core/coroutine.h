@@ -0,0 +1,80 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+#include <QtGlobal>
+
+#include <functional>
+
+#if defined(Q_OS_WIN)
+#define QSGS_COROUTINE_FIBER
+#elif defined(Q_OS_UNIX) && !defined(Q_OS_ANDROID)
+#define QSGS_COROUTINE_UCONTEXT
+#include <ucontext.h>
+#endif
+
+//A stackful coroutine. resume() runs the function until it calls yield() or returns.
+//A suspended coroutine may be resumed by any thread, but by one thread at a time.
+//Nothing is kept in thread-local storage, as the thread may change at every yield().
+class Coroutine
+{
+public:
+    typedef std::function<void()> Function;
+
+    enum { DefaultStackSize = 512 * 1024 };
+
+    Coroutine(const Function &func, int stackSize = DefaultStackSize);
+    ~Coroutine();
+
+    void resume();
+    //Must be called from inside the coroutine. Returns to the caller of the last resume().
+    void yield();
+    bool isFinished() const { return m_finished; }
+
+    //False on the platforms without a context switching backend
+    static bool isSupported();
+
+private:
+    Q_DISABLE_COPY(Coroutine)
+
+    void exec();
+
+    Function m_func;
+    bool m_finished;
+
+#if defined(QSGS_COROUTINE_FIBER)
+    static void __stdcall FiberEntry(void *param);
+
+    void *m_fiber;
+    void *m_callerFiber;
+#elif defined(QSGS_COROUTINE_UCONTEXT)
+    static void ContextEntry(int high, int low);
+
+    //The stack is mapped with a guard page at its bottom
+    char *m_stack;
+    size_t m_stackSize;
+    ucontext_t m_context;
+    ucontext_t m_callerContext;
+#endif
+};
+
+#endif // COROUTINE_H
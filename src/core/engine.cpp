@@ -22,7 +22,12 @@
 #include "package.h"
 #include "general.h"
 
+#include <QCoreApplication>
+
+#include <algorithm>
+
 Engine::Engine()
+    : m_namesInterned(false)
 {
 }
 
@@ -38,8 +43,15 @@ Engine::~Engine()
         delete package;
 }
 
+static bool PackageNameLessThan(const Package *a, const Package *b)
+{
+    return a->name() < b->name();
+}
+
 void Engine::addPackage(Package *package)
 {
+    if (m_namesInterned)
+        qWarning("Package %s is added after the card names were interned. Its card names have no ids.", qPrintable(package->name()));
     m_packages << package;
 
     QList<const General *> generals = package->generals();
@@ -51,6 +63,27 @@ void Engine::addPackage(Package *package)
         m_cards.insert(card->id(), card);
 }
 
+void Engine::internNames()
+{
+    if (m_namesInterned)
+        return;
+    m_namesInterned = true;
+
+    //Packages are added by static initializers, whose order may differ between the client and the server.
+    //Names are interned in the order of package names, so that their ids are the same in every process.
+    QList<Package *> packages = m_packages;
+    std::sort(packages.begin(), packages.end(), PackageNameLessThan);
+    foreach (Package *package, packages)
+        package->internNames();
+}
+
+//Runs when the application object is created, after the static initializers have added all the packages
+static void InternCardNames()
+{
+    Engine::instance()->internNames();
+}
+Q_COREAPP_STARTUP_FUNCTION(InternCardNames)
+
 const Package *Engine::package(const QString &name) const
 {
     foreach (Package *package, m_packages) {
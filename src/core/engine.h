@@ -36,6 +36,8 @@ public:
     ~Engine();
 
     void addPackage(Package *package);
+    //Gives ids to the card names of all the packages. It is called once when the application object is created.
+    void internNames();
     const Package *package(const QString &name) const;
     QList<const Package *> packages() const;
 
@@ -51,6 +53,7 @@ private:
     QList<Package *> m_packages;
     QMap<QString, const General *> m_generals;
     QMap<uint, const Card *> m_cards;
+    bool m_namesInterned;
 };
 
 #define ADD_PACKAGE(name) struct name##PackageAdder\
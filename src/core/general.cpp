@@ -39,6 +39,29 @@ General::~General()
         delete skill;
 }
 
+void General::addSkill(Skill *skill)
+{
+    m_skills << skill;
+}
+
+bool General::hasSkill(const Skill *skill) const
+{
+    foreach (const Skill *s, m_skills) {
+        if (s == skill)
+            return true;
+    }
+    return false;
+}
+
+QList<const Skill *> General::getSkillList() const
+{
+    QList<const Skill *> skills;
+    skills.reserve(m_skills.length());
+    foreach (const Skill *skill, m_skills)
+        skills << skill;
+    return skills;
+}
+
 bool General::isCompanionWith(const General *general) const
 {
     if (m_companions.contains(general->name()))
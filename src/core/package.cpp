@@ -20,6 +20,7 @@
 #include "package.h"
 #include "card.h"
 #include "general.h"
+#include "stringpool.h"
 
 Package::Package(const QString &name)
     : m_name(name)
@@ -54,3 +55,10 @@ QList<const Card *> Package::cards() const
         cards << card;
     return cards;
 }
+
+void Package::internNames()
+{
+    StringPool *cardNames = StringPool::cardNames();
+    foreach (Card *card, m_cards)
+        card->setNameId(cardNames->intern(card->objectName()));
+}
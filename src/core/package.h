@@ -36,6 +36,9 @@ public:
     QList<const General *> generals(bool includeHidden = false) const;
     QList<const Card *> cards() const;
 
+    //Interns the names of the cards of the package. Called by Engine once all the packages are added.
+    void internNames();
+
 protected:
     void addGeneral(General *general) { m_generals << general; }
     void addGenerals(const QList<General *> &generals) { m_generals << generals; }
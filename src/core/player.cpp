@@ -21,12 +21,19 @@
 #include "player.h"
 #include "general.h"
 #include "engine.h"
+#include "playerring.h"
+#include "skill.h"
+#include "stringpool.h"
 
 Player::Player(QObject *parent)
     : CAbstractPlayer(parent)
     , m_hp(0)
     , m_maxHp(0)
     , m_alive(true)
+    , m_removed(false)
+    , m_seat(0)
+    , m_next(nullptr)
+    , m_ring(nullptr)
     , m_headGeneral(nullptr)
     , m_deputyGeneral(nullptr)
     , m_turnCount(0)
@@ -58,6 +65,27 @@ Player::~Player()
     delete m_judgeCards;
 }
 
+const char *Player::propertyName(Property property)
+{
+    static const char *names[PropertyCount] = {
+        "screenName",
+        "hp",
+        "maxHp",
+        "isAlive",
+        "isRemoved",
+        "seat",
+        "phase",
+        "headGeneralName",
+        "deputyGeneralName",
+        "turnCount",
+        "faceUp",
+        "drank",
+        "kingdom",
+        "role"
+    };
+    return property >= 0 && property < PropertyCount ? names[property] : nullptr;
+}
+
 void Player::setScreenName(const QString &name)
 {
     m_screenName = name;
@@ -79,13 +107,26 @@ void Player::setMaxHp(int maxHp)
 void Player::setAlive(bool alive)
 {
     m_alive = alive;
+    if (m_ring)
+        m_ring->setAlive(m_seat, alive);
     emit aliveChanged();
 }
 
+void Player::addSkill(const Skill *skill)
+{
+    if (!m_skills.contains(skill))
+        m_skills << skill;
+}
+
+void Player::removeSkill(const Skill *skill)
+{
+    m_skills.removeOne(skill);
+}
+
 bool Player::hasSkill(const EventHandler *skill) const
 {
-    Q_UNUSED(skill)
-    return false;
+    const TriggerSkill *triggerSkill = dynamic_cast<const TriggerSkill *>(skill);
+    return triggerSkill != nullptr && m_skills.contains(triggerSkill);
 }
 
 bool Player::hasShownSkill(const EventHandler *skill) const
@@ -98,40 +139,36 @@ bool Player::hasShownSkill(const EventHandler *skill) const
 void Player::setRemoved(bool removed)
 {
     m_removed = removed;
+    if (m_ring)
+        m_ring->setRemoved(m_seat, removed);
     emit removedChanged();
 }
 
 void Player::setSeat(int seat)
 {
+    int oldSeat = m_seat;
     m_seat = seat;
+    if (m_ring && oldSeat != seat)
+        m_ring->setSeat(this, oldSeat, seat);
     emit seatChanged();
 }
 
 Player *Player::next(bool ignoreRemoved) const
 {
-    Player *next = this->next();
-    if (ignoreRemoved) {
-        while (next->isRemoved())
-            next = next->next();
-    }
-    return next;
+    if (!ignoreRemoved || m_ring == nullptr)
+        return next();
+    return m_ring->next(this, m_ring->seats() & ~m_ring->removedSeats());
 }
 
 Player *Player::nextAlive(int step, bool ignoreRemoved) const
 {
-    Player *cur = next();
-    forever {
-        if (cur->isAlive() && !(ignoreRemoved && cur->isRemoved())) {
-            step--;
-            if (step <= 0)
-                break;
-        }
-
-        cur = cur->next();
-        if (cur == this)
-            break;
-    }
-    return cur;
+    if (m_ring == nullptr)
+        return next();
+
+    quint32 mask = m_ring->aliveSeats();
+    if (ignoreRemoved)
+        mask &= ~m_ring->removedSeats();
+    return m_ring->next(this, mask, step);
 }
 
 void Player::setPhase(Phase phase)
@@ -237,12 +274,26 @@ int Player::delayedTrickNum() const
     return m_delayedTricks->length();
 }
 
-void Player::addCardHistory(const QString &name, int times)
+int Player::cardHistory(const QString &name) const
 {
-    if (m_cardHistory.contains(name))
-        m_cardHistory[name] += times;
-    else
-        m_cardHistory[name] = times;
+    return cardHistory(StringPool::cardNames()->find(name));
+}
+
+void Player::addCardHistory(uint nameId, int times)
+{
+    if (nameId == 0)
+        return;
+    if (nameId >= uint(m_cardHistory.size()))
+        m_cardHistory.resize(nameId + 1);
+    m_cardHistory[nameId] += times;
+}
+
+void Player::setCardTable(CardTable *table)
+{
+    m_handcards->setCardTable(table);
+    m_equips->setCardTable(table);
+    m_delayedTricks->setCardTable(table);
+    m_judgeCards->setCardTable(table);
 }
 
 void Player::setDrank(int drank)
@@ -22,13 +22,17 @@
 
 class Card;
 class CardArea;
+class CardTable;
 class EventHandler;
 class General;
+class PlayerRing;
+class Skill;
 
 #include <cabstractplayer.h>
 
 #include <QList>
 #include <QSet>
+#include <QVector>
 
 class Player : public CAbstractPlayer
 {
@@ -68,9 +72,32 @@ public:
         InvalidPhase, RoundStart, Start, Judge, Draw, Play, Discard, Finish, NotActive
     };
 
+    //Ids of the properties synchronized from the server. Append new ids to keep the wire format stable.
+    enum Property
+    {
+        ScreenNameProperty,
+        HpProperty,
+        MaxHpProperty,
+        AliveProperty,
+        RemovedProperty,
+        SeatProperty,
+        PhaseProperty,
+        HeadGeneralNameProperty,
+        DeputyGeneralNameProperty,
+        TurnCountProperty,
+        FaceUpProperty,
+        DrankProperty,
+        KingdomProperty,
+        RoleProperty,
+
+        PropertyCount
+    };
+
     Player(QObject *parent = 0);
     ~Player();
 
+    static const char *propertyName(Property property);
+
     QString screenName() const { return m_screenName; }
     void setScreenName(const QString &name);
 
@@ -88,6 +115,9 @@ public:
     void setDead(bool dead) { setAlive(!dead); }
     bool isDead() const { return !m_alive; }
 
+    void addSkill(const Skill *skill);
+    void removeSkill(const Skill *skill);
+    QList<const Skill *> skills() const { return m_skills; }
     bool hasSkill(const EventHandler *skill) const;
     bool hasShownSkill(const EventHandler *skill) const;
 
@@ -97,6 +127,8 @@ public:
     void setSeat(int seat);
     int seat() const { return m_seat; }
 
+    //The ring is set once the seats are arranged, see PlayerRing::arrange()
+    const PlayerRing *ring() const { return m_ring; }
     void setNext(Player *next) { m_next = next; }
     Player *next() const { return m_next; }
     Player *next(bool ignoreRemoved) const;
@@ -153,8 +185,13 @@ public:
     CardArea *judgeCards() { return m_judgeCards; }
     const CardArea *judgeCards() const { return m_judgeCards; }
 
-    int cardHistory(const QString &name) const { return m_cardHistory.value(name); }
-    void addCardHistory(const QString &name, int times = 1);
+    void setCardTable(CardTable *table);
+
+    //Times each card name was used in the turn, indexed by Card::nameId()
+    int cardHistory(uint nameId) const { return nameId < uint(m_cardHistory.size()) ? m_cardHistory.at(nameId) : 0; }
+    int cardHistory(const QString &name) const;
+    const QVector<int> &cardHistory() const { return m_cardHistory; }
+    void addCardHistory(uint nameId, int times = 1);
     void clearCardHistory() { m_cardHistory.clear(); }
 
     void setDrank(int drank);
@@ -196,6 +233,7 @@ protected:
     bool m_removed;
     int m_seat;
     Player *m_next;
+    PlayerRing *m_ring;
     Phase m_phase;
     const General *m_headGeneral;
     const General *m_deputyGeneral;
@@ -210,10 +248,14 @@ protected:
     CardArea *m_delayedTricks;
     CardArea *m_judgeCards;
 
-    QHash<QString, int> m_cardHistory;
+    QList<const Skill *> m_skills;
+
+    QVector<int> m_cardHistory;
     int m_drank;
     QString m_kingdom;
     QString m_role;
+
+    friend class PlayerRing;
 };
 
 #endif // PLAYER_H
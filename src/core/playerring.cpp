@@ -0,0 +1,119 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+#include "player.h"
+#include "playerring.h"
+
+PlayerRing::PlayerRing()
+    : m_seatNum(0)
+    , m_aliveSeats(0)
+    , m_removedSeats(0)
+{
+    for (int seat = 0; seat <= MaxSeatNum; seat++)
+        m_players[seat] = nullptr;
+}
+
+void PlayerRing::arrange(const QList<Player *> &players)
+{
+    clear();
+
+    Q_ASSERT(players.length() <= MaxSeatNum);
+    m_seatNum = qMin<int>(players.length(), MaxSeatNum);
+    for (int seat = 1; seat <= m_seatNum; seat++) {
+        Player *player = players.at(seat - 1);
+        m_players[seat] = player;
+        player->setSeat(seat);
+        player->setNext(players.at(seat % m_seatNum));
+        player->m_ring = this;
+
+        if (player->isAlive())
+            m_aliveSeats |= 1u << seat;
+        if (player->isRemoved())
+            m_removedSeats |= 1u << seat;
+    }
+}
+
+void PlayerRing::clear()
+{
+    //Players left out of the next arrangement no longer change the masks
+    for (int seat = 0; seat <= MaxSeatNum; seat++) {
+        Player *player = m_players[seat];
+        if (player && player->m_ring == this)
+            player->m_ring = nullptr;
+        m_players[seat] = nullptr;
+    }
+    m_seatNum = 0;
+    m_aliveSeats = 0;
+    m_removedSeats = 0;
+}
+
+void PlayerRing::setAlive(int seat, bool alive)
+{
+    if (alive)
+        m_aliveSeats |= 1u << seat;
+    else
+        m_aliveSeats &= ~(1u << seat);
+}
+
+void PlayerRing::setRemoved(int seat, bool removed)
+{
+    if (removed)
+        m_removedSeats |= 1u << seat;
+    else
+        m_removedSeats &= ~(1u << seat);
+}
+
+void PlayerRing::setSeat(Player *player, int oldSeat, int seat)
+{
+    //While seats are swapped, the old seat may already belong to another player
+    if (0 < oldSeat && oldSeat <= m_seatNum && m_players[oldSeat] == player) {
+        m_players[oldSeat] = nullptr;
+        m_aliveSeats &= ~(1u << oldSeat);
+        m_removedSeats &= ~(1u << oldSeat);
+    }
+
+    if (seat <= 0 || seat > m_seatNum) {
+        player->m_ring = nullptr;
+        return;
+    }
+
+    m_players[seat] = player;
+    setAlive(seat, player->isAlive());
+    setRemoved(seat, player->isRemoved());
+
+    for (int i = 1; i <= m_seatNum; i++) {
+        Player *next = m_players[i % m_seatNum + 1];
+        if (m_players[i] && next)
+            m_players[i]->setNext(next);
+    }
+}
+
+Player *PlayerRing::next(const Player *player, quint32 mask, int step) const
+{
+    int seat = player->seat();
+    for (int i = 1; i < m_seatNum; i++) {
+        seat = seat % m_seatNum + 1;
+        if ((mask >> seat) & 1) {
+            step--;
+            if (step <= 0)
+                return m_players[seat];
+        }
+    }
+    return m_players[player->seat()];
+}
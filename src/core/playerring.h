@@ -0,0 +1,106 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+#ifndef PLAYERRING_H
+#define PLAYERRING_H
+
+#include <QList>
+
+class Player;
+
+//Seat-indexed players of a room. Bit n of the masks stands for seat n.
+class PlayerRing
+{
+public:
+    enum { MaxSeatNum = 31 };
+
+    //Iterates the players whose seats are in the mask, in seat order from a starting seat
+    template<typename T>
+    class Range
+    {
+    public:
+        class const_iterator
+        {
+        public:
+            const_iterator(const PlayerRing *ring, quint32 mask, int seat, int remaining)
+                : m_ring(ring), m_mask(mask), m_seat(seat), m_remaining(remaining)
+            {
+                skip();
+            }
+
+            T *operator*() const { return static_cast<T *>(m_ring->at(m_seat)); }
+            const_iterator &operator++() { step(); skip(); return *this; }
+            bool operator==(const const_iterator &other) const { return m_remaining == other.m_remaining; }
+            bool operator!=(const const_iterator &other) const { return m_remaining != other.m_remaining; }
+
+        private:
+            void step() { m_seat = m_seat % m_ring->length() + 1; m_remaining--; }
+            void skip() { while (m_remaining > 0 && ((m_mask >> m_seat) & 1) == 0) step(); }
+
+            const PlayerRing *m_ring;
+            quint32 m_mask;
+            int m_seat;
+            int m_remaining;
+        };
+        typedef const_iterator iterator;
+
+        Range(const PlayerRing *ring, quint32 mask, int seat) : m_ring(ring), m_mask(mask), m_seat(seat) {}
+
+        const_iterator begin() const { return const_iterator(m_ring, m_mask, m_seat, m_ring->length()); }
+        const_iterator end() const { return const_iterator(m_ring, m_mask, m_seat, 0); }
+
+    private:
+        const PlayerRing *m_ring;
+        quint32 m_mask;
+        int m_seat;
+    };
+
+    PlayerRing();
+
+    //Seats the players in order from seat 1 and links them into a ring
+    void arrange(const QList<Player *> &players);
+    void clear();
+
+    int length() const { return m_seatNum; }
+    Player *at(int seat) const { return seat > 0 && seat <= m_seatNum ? m_players[seat] : nullptr; }
+
+    quint32 seats() const { return ((1u << m_seatNum) - 1) << 1; }
+    quint32 aliveSeats() const { return m_aliveSeats; }
+    quint32 removedSeats() const { return m_removedSeats; }
+
+    //Called by Player once its state changes
+    void setAlive(int seat, bool alive);
+    void setRemoved(int seat, bool removed);
+    //The player takes the seat with its alive and removed bits, and leaves the ring if the seat is out of it
+    void setSeat(Player *player, int oldSeat, int seat);
+
+    //The step-th player after the given one whose seat is in the mask. Returns the player itself if there is none.
+    Player *next(const Player *player, quint32 mask, int step = 1) const;
+
+    template<typename T>
+    Range<T> players(int seat, quint32 mask) const { return Range<T>(this, mask, seat); }
+
+private:
+    Player *m_players[MaxSeatNum + 1];
+    int m_seatNum;
+    quint32 m_aliveSeats;
+    quint32 m_removedSeats;
+};
+
+#endif // PLAYERRING_H
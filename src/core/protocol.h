@@ -34,6 +34,10 @@ enum SanguoshaCommand
     S_COMMAND_USE_CARD,
     S_COMMAND_ADD_CARD_HISTORY,
     S_COMMAND_DAMAGE,
+    S_COMMAND_SYNC_STATE,
+    S_COMMAND_NEGOTIATE_PROTOCOL,
+    S_COMMAND_RECONNECT_TOKEN,
+    S_COMMAND_RECONNECT,
 
     SANGUOSHA_COMMAND_COUNT
 };
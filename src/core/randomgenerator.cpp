@@ -0,0 +1,53 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+
+#include "randomgenerator.h"
+
+#include <QAtomicInt>
+#include <QDateTime>
+
+static quint64 SplitMix64(quint64 &x)
+{
+    quint64 z = (x += Q_UINT64_C(0x9E3779B97F4A7C15));
+    z = (z ^ (z >> 30)) * Q_UINT64_C(0xBF58476D1CE4E5B9);
+    z = (z ^ (z >> 27)) * Q_UINT64_C(0x94D049BB133111EB);
+    return z ^ (z >> 31);
+}
+
+void RandomGenerator::setSeed(quint64 seed)
+{
+    m_seed = seed;
+
+    //Expand the seed with splitmix64, as recommended by the authors of xoshiro
+    quint64 x = seed;
+    quint64 a = SplitMix64(x);
+    quint64 b = SplitMix64(x);
+    m_state[0] = quint32(a);
+    m_state[1] = quint32(a >> 32);
+    m_state[2] = quint32(b);
+    m_state[3] = quint32(b >> 32);
+}
+
+quint64 RandomGenerator::makeSeed()
+{
+    static QAtomicInt counter(0);
+    quint64 x = quint64(QDateTime::currentMSecsSinceEpoch()) ^ (quint64(quint32(counter.fetchAndAddRelaxed(1))) << 44);
+    return SplitMix64(x);
+}
@@ -0,0 +1,74 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+
+#ifndef RANDOMGENERATOR_H
+#define RANDOMGENERATOR_H
+
+#include <QtGlobal>
+
+//xoshiro128** seeded through splitmix64. Each room owns one, so that a game can be replayed from its seed.
+class RandomGenerator
+{
+public:
+    RandomGenerator(quint64 seed = 0) { setSeed(seed); }
+
+    quint64 seed() const { return m_seed; }
+    void setSeed(quint64 seed);
+
+    quint32 generate()
+    {
+        quint32 result = rotl(m_state[1] * 5, 7) * 9;
+        quint32 t = m_state[1] << 9;
+        m_state[2] ^= m_state[0];
+        m_state[3] ^= m_state[1];
+        m_state[1] ^= m_state[2];
+        m_state[0] ^= m_state[3];
+        m_state[2] ^= t;
+        m_state[3] = rotl(m_state[3], 11);
+        return result;
+    }
+
+    //Uniformly distributed in [0, bound)
+    quint32 bounded(quint32 bound)
+    {
+        //Lemire's multiply-shift, rejecting the biased low products
+        quint64 product = quint64(generate()) * bound;
+        quint32 low = quint32(product);
+        if (low < bound) {
+            quint32 threshold = quint32(-bound) % bound;
+            while (low < threshold) {
+                product = quint64(generate()) * bound;
+                low = quint32(product);
+            }
+        }
+        return quint32(product >> 32);
+    }
+
+    //A seed that differs between rooms started at the same time
+    static quint64 makeSeed();
+
+private:
+    static quint32 rotl(quint32 x, int k) { return (x << k) | (x >> (32 - k)); }
+
+    quint64 m_seed;
+    quint32 m_state[4];
+};
+
+#endif // RANDOMGENERATOR_H
@@ -0,0 +1,60 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+#include "stringpool.h"
+
+uint StringPool::intern(const QString &str)
+{
+    uint id = find(str);
+    if (id)
+        return id;
+
+    QWriteLocker locker(&m_lock);
+    id = m_ids.value(str);
+    if (id == 0) {
+        m_strings << str;
+        id = m_strings.length();
+        m_ids.insert(str, id);
+    }
+    return id;
+}
+
+uint StringPool::find(const QString &str) const
+{
+    QReadLocker locker(&m_lock);
+    return m_ids.value(str);
+}
+
+QString StringPool::string(uint id) const
+{
+    QReadLocker locker(&m_lock);
+    return 0 < id && id <= uint(m_strings.length()) ? m_strings.at(id - 1) : QString();
+}
+
+int StringPool::size() const
+{
+    QReadLocker locker(&m_lock);
+    return m_strings.length();
+}
+
+StringPool *StringPool::cardNames()
+{
+    static StringPool pool;
+    return &pool;
+}
@@ -0,0 +1,48 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <QString>
+#include <QStringList>
+
+//Assigns small ids to strings in the order they are interned, starting from 1. 0 stands for an unknown string.
+//Engine interns the names of every package once all of them are loaded, sorted by package name, so that
+//clients and servers of the same version agree on the ids. Nothing is interned while a game runs.
+class StringPool
+{
+public:
+    uint intern(const QString &str);
+    uint find(const QString &str) const;
+    QString string(uint id) const;
+    int size() const;
+
+    //Names of the cards, see Card::nameId()
+    static StringPool *cardNames();
+
+private:
+    mutable QReadWriteLock m_lock;
+    QHash<QString, uint> m_ids;
+    QStringList m_strings;
+};
+
+#endif // STRINGPOOL_H
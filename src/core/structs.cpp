@@ -20,6 +20,7 @@
 #include "card.h"
 #include "player.h"
 #include "structs.h"
+#include "wireformat.h"
 
 CardsMoveStruct::Area::Area()
     : type(CardArea::Unknown)
@@ -38,6 +39,14 @@ QVariant CardsMoveStruct::Area::toVariant() const
     return data;
 }
 
+void CardsMoveStruct::Area::encode(WireWriter &writer) const
+{
+    writer.writeByte(type);
+    writer.writeByte(direction);
+    writer.writeVarint(owner ? owner->id() : 0);
+    writer.writeString(name);
+}
+
 CardsMoveStruct::CardsMoveStruct()
     : isOpen(false)
     , isLastHandCard(false)
@@ -76,6 +85,22 @@ QVariant CardsMoveStruct::toVariant(bool open) const
     return data;
 }
 
+void CardsMoveStruct::encode(WireWriter &writer, bool open) const
+{
+    from.encode(writer);
+    to.encode(writer);
+
+    bool shown = isOpen || open;
+    writer.writeBool(isOpen);
+    writer.writeBool(isLastHandCard);
+    writer.writeBool(shown);
+    writer.writeVarint(cards.length());
+    if (shown) {
+        foreach (const Card *card, cards)
+            writer.writeVarint(card->id());
+    }
+}
+
 CardUseStruct::CardUseStruct()
     : from(nullptr)
     , card(nullptr)
@@ -92,6 +117,7 @@ CardEffectStruct::CardEffectStruct()
     , to(nullptr)
     , multiple(false)
     , nullified(false)
+    , drank(0)
 {
 }
 
@@ -107,3 +133,15 @@ DamageStruct::DamageStruct()
     , prevented(false)
 {
 }
+
+SlashEffectStruct::SlashEffectStruct()
+    : from(nullptr)
+    , to(nullptr)
+    , slash(nullptr)
+    , jink(nullptr)
+    , nature(DamageStruct::Normal)
+    , drank(0)
+    , jinkNum(1)
+    , nullified(false)
+{
+}
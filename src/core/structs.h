@@ -29,6 +29,7 @@
 
 class Card;
 class ServerPlayer;
+class WireWriter;
 
 struct CardsMoveStruct
 {
@@ -41,11 +42,12 @@ struct CardsMoveStruct
 
         Area();
         QVariant toVariant() const;
+        void encode(WireWriter &writer) const;
     };
 
     Area from;
     Area to;
-    QList<Card *> cards;
+    QList<const Card *> cards;
     bool isOpen;
     bool isLastHandCard;
     CardsMoveStruct *origin;
@@ -55,6 +57,8 @@ struct CardsMoveStruct
 
     bool isRelevant(const Player *player) const;
     QVariant toVariant(bool open = false) const;
+    //Binary form of toVariant()
+    void encode(WireWriter &writer, bool open = false) const;
 };
 
 Q_DECLARE_METATYPE(QList<CardsMoveStruct> *)
@@ -79,7 +83,7 @@ struct CardUseStruct
 
     ServerPlayer *from;
     QList<ServerPlayer *> to;
-    Card *card;
+    const Card *card;
     QList<ServerPlayer *> nullifiedList;
     bool isOwnerUse;
     bool addHistory;
@@ -93,11 +97,12 @@ Q_DECLARE_METATYPE(CardUseStruct *)
 
 struct CardEffectStruct
 {
-    Card *card;
+    const Card *card;
     ServerPlayer *from;
     ServerPlayer *to;
     bool multiple;  //It's true iff the card has more than 1 target
     bool nullified; //Does not make sense if it's a skill card
+    int drank;      //Drank of the user, taken by the first effect of a slash and kept for the other targets
 
     CardEffectStruct();
 };
@@ -130,4 +135,22 @@ struct DamageStruct
 
 Q_DECLARE_METATYPE(DamageStruct *)
 
+struct SlashEffectStruct
+{
+    ServerPlayer *from;
+    ServerPlayer *to;
+
+    const Card *slash;
+    const Card *jink;
+
+    DamageStruct::Nature nature;
+    int drank;
+    int jinkNum;
+    bool nullified;
+
+    SlashEffectStruct();
+};
+
+Q_DECLARE_METATYPE(SlashEffectStruct *)
+
 #endif // STRUCTS_H
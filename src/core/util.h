@@ -24,12 +24,13 @@
 #include <QObject>
 #include <QVariant>
 
-template<class T>
-void qShuffle(QList<T> &list)
+//Fisher-Yates shuffle. The generator must provide bounded(n), see RandomGenerator.
+template<class T, class Generator>
+void qShuffle(QList<T> &list, Generator &generator)
 {
     int i, n = list.length();
-    for (i = 0; i < n; i++) {
-        int r = qrand() % (n - i) + i;
+    for (i = 0; i < n - 1; i++) {
+        int r = generator.bounded(n - i) + i;
         list.swap(i, r);
     }
 }
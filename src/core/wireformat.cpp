@@ -0,0 +1,137 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+#include "wireformat.h"
+
+enum VariantTag
+{
+    NullTag,
+    BoolTag,
+    IntTag,
+    StringTag,
+    UIntTag
+};
+
+WireWriter::WireWriter()
+{
+    writeByte(Version);
+}
+
+void WireWriter::writeVarint(quint32 value)
+{
+    while (value >= 0x80) {
+        writeByte(quint8(value | 0x80));
+        value >>= 7;
+    }
+    writeByte(quint8(value));
+}
+
+void WireWriter::writeString(const QString &value)
+{
+    QByteArray data = value.toUtf8();
+    writeVarint(data.size());
+    m_data.append(data);
+}
+
+void WireWriter::writeVariant(const QVariant &value)
+{
+    switch (value.type()) {
+    case QVariant::Invalid:
+        writeByte(NullTag);
+        break;
+    case QVariant::Bool:
+        writeByte(BoolTag);
+        writeBool(value.toBool());
+        break;
+    case QVariant::Int:
+        writeByte(IntTag);
+        writeSignedVarint(value.toInt());
+        break;
+    case QVariant::UInt:
+        writeByte(UIntTag);
+        writeVarint(value.toUInt());
+        break;
+    case QVariant::String:
+        writeByte(StringTag);
+        writeString(value.toString());
+        break;
+    default:
+        qWarning("WireWriter: variants of type %s are not supported", value.typeName());
+        writeByte(NullTag);
+    }
+}
+
+WireReader::WireReader(const QVariant &data)
+    : m_pos(0)
+    , m_valid(false)
+{
+    if (isBinary(data)) {
+        m_data = QByteArray::fromBase64(data.toString().toLatin1());
+        m_valid = readByte() == WireWriter::Version;
+    }
+}
+
+quint8 WireReader::readByte()
+{
+    if (atEnd()) {
+        m_valid = false;
+        return 0;
+    }
+    return quint8(m_data.at(m_pos++));
+}
+
+quint32 WireReader::readVarint()
+{
+    quint32 value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        quint8 byte = readByte();
+        value |= quint32(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+            break;
+    }
+    return value;
+}
+
+QString WireReader::readString()
+{
+    int size = readVarint();
+    if (size > m_data.size() - m_pos) {
+        m_valid = false;
+        return QString();
+    }
+    QString value = QString::fromUtf8(m_data.constData() + m_pos, size);
+    m_pos += size;
+    return value;
+}
+
+QVariant WireReader::readVariant()
+{
+    switch (readByte()) {
+    case BoolTag:
+        return readBool();
+    case IntTag:
+        return readSignedVarint();
+    case UIntTag:
+        return readVarint();
+    case StringTag:
+        return readString();
+    default:
+        return QVariant();
+    }
+}
@@ -0,0 +1,78 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+#ifndef WIREFORMAT_H
+#define WIREFORMAT_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVariant>
+
+//Compact binary encoding of the frequent commands, used once a client replies to S_COMMAND_NEGOTIATE_PROTOCOL with the same version.
+//Fields are written in a fixed order: unsigned integers as varints, enums as single bytes.
+//The payload starts with the version byte and travels base64-encoded, as packets are JSON documents.
+class WireWriter
+{
+public:
+    enum { Version = 2 };
+
+    WireWriter();
+
+    void writeByte(quint8 value) { m_data.append(char(value)); }
+    void writeBool(bool value) { writeByte(value ? 1 : 0); }
+    void writeVarint(quint32 value);
+    void writeSignedVarint(qint32 value) { writeVarint((quint32(value) << 1) ^ quint32(value >> 31)); }
+    void writeString(const QString &value);
+    //Null, bool, int, uint and string values. Other types are written as null with a warning.
+    void writeVariant(const QVariant &value);
+    void writeRaw(const QByteArray &data) { m_data.append(data); }
+
+    //Raw bytes, without the version byte of the payload
+    QByteArray body() const { return m_data.mid(1); }
+    QVariant toVariant() const { return QString::fromLatin1(m_data.toBase64()); }
+
+private:
+    QByteArray m_data;
+};
+
+class WireReader
+{
+public:
+    //Invalid if the data is not a binary payload of a known version
+    WireReader(const QVariant &data);
+
+    static bool isBinary(const QVariant &data) { return data.type() == QVariant::String; }
+
+    bool isValid() const { return m_valid; }
+    bool atEnd() const { return m_pos >= m_data.size(); }
+
+    quint8 readByte();
+    bool readBool() { return readByte() != 0; }
+    quint32 readVarint();
+    qint32 readSignedVarint() { quint32 value = readVarint(); return qint32(value >> 1) ^ -qint32(value & 1); }
+    QString readString();
+    QVariant readVariant();
+
+private:
+    QByteArray m_data;
+    int m_pos;
+    bool m_valid;
+};
+
+#endif // WIREFORMAT_H
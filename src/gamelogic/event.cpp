@@ -18,6 +18,7 @@
 *********************************************************************/
 
 #include "event.h"
+#include "serverplayer.h"
 
 Event::Event()
     : handler(nullptr)
@@ -36,3 +37,40 @@ Event::Event(const EventHandler *handler, ServerPlayer *owner)
     , owner(owner)
 {
 }
+
+EventList::EventList()
+    : m_ownerSeats(0)
+{
+}
+
+void EventList::append(const Event &event)
+{
+    m_events.append(event);
+    if (event.owner)
+        m_ownerSeats |= 1u << event.owner->seat();
+}
+
+void EventList::clear()
+{
+    m_events.clear();
+    m_ownerSeats = 0;
+}
+
+bool EventList::hasOwner(const ServerPlayer *owner) const
+{
+    return (m_ownerSeats >> owner->seat()) & 1;
+}
+
+EventList EventList::eventsOf(const ServerPlayer *owner) const
+{
+    EventList events;
+    if (!hasOwner(owner))
+        return events;
+
+    for (int i = 0; i < m_events.size(); i++) {
+        const Event &event = m_events.at(i);
+        if (event.owner == owner)
+            events.append(event);
+    }
+    return events;
+}
@@ -23,7 +23,7 @@
 class EventHandler;
 class ServerPlayer;
 
-#include <QList>
+#include <QVarLengthArray>
 
 struct Event
 {
@@ -31,11 +31,37 @@ struct Event
     Event(const EventHandler *handler);
     Event(const EventHandler *handler, ServerPlayer *owner);
 
-    bool isValid() { return handler != nullptr; }
+    bool isValid() const { return handler != nullptr; }
 
     const EventHandler *handler;
     ServerPlayer *owner;
-    QList<ServerPlayer *> to;
+    QVarLengthArray<ServerPlayer *, 4> to;
+};
+
+//Stack-backed buffer that collects the triggerable events of a trigger, grouped by the seats of their owners
+class EventList
+{
+public:
+    EventList();
+
+    void append(const Event &event);
+    EventList &operator<<(const Event &event) { append(event); return *this; }
+    void removeAt(int i) { m_events.remove(i); }
+    void clear();
+
+    bool isEmpty() const { return m_events.isEmpty(); }
+    int length() const { return m_events.size(); }
+
+    const Event &at(int i) const { return m_events.at(i); }
+    Event &operator[](int i) { return m_events[i]; }
+    const Event &first() const { return m_events.at(0); }
+
+    bool hasOwner(const ServerPlayer *owner) const;
+    EventList eventsOf(const ServerPlayer *owner) const;
+
+private:
+    QVarLengthArray<Event, 8> m_events;
+    quint32 m_ownerSeats;
 };
 
 #endif // EVENT_H
@@ -0,0 +1,53 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+#include "eventdata.h"
+
+QVariant EventData::toVariant() const
+{
+    switch (m_type) {
+    case IntData:
+        return *static_cast<int *>(m_data);
+    case CardsMoveData:
+        return QVariant::fromValue(static_cast<QList<CardsMoveStruct> *>(m_data));
+    case PhaseChangeData:
+        return QVariant::fromValue(static_cast<PhaseChangeStruct *>(m_data));
+    case CardUseData:
+        return QVariant::fromValue(static_cast<CardUseStruct *>(m_data));
+    case CardEffectData:
+        return QVariant::fromValue(static_cast<CardEffectStruct *>(m_data));
+    case SlashEffectData:
+        return QVariant::fromValue(static_cast<SlashEffectStruct *>(m_data));
+    case DamageData:
+        return QVariant::fromValue(static_cast<DamageStruct *>(m_data));
+    default:
+        return QVariant();
+    }
+}
+
+EventData::Type EventData::typeOf(EventType event)
+{
+#define EVENT_PAYLOAD_CASE(event, type) case event: return TypeOf<type>::value;
+    switch (event) {
+    EVENT_PAYLOAD_LIST(EVENT_PAYLOAD_CASE)
+    default:
+        return NullData;
+    }
+#undef EVENT_PAYLOAD_CASE
+}
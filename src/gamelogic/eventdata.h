@@ -0,0 +1,120 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+#ifndef EVENTDATA_H
+#define EVENTDATA_H
+
+#include "eventtype.h"
+#include "structs.h"
+
+#include <QList>
+#include <QVariant>
+
+//Typed reference to the payload of an event, replacing the pointers wrapped in QVariant
+class EventData
+{
+public:
+    enum Type
+    {
+        NullData,
+        IntData,
+        CardsMoveData,
+        PhaseChangeData,
+        CardUseData,
+        CardEffectData,
+        SlashEffectData,
+        DamageData
+    };
+
+    template<typename T> struct TypeOf;
+
+    EventData() : m_type(NullData), m_data(nullptr) {}
+    template<typename T> explicit EventData(T *data) : m_type(TypeOf<T>::value), m_data(data) {}
+
+    Type type() const { return m_type; }
+    bool isNull() const { return m_type == NullData; }
+
+    //Returns nullptr if the payload is not a T
+    template<typename T> T *value() const { return m_type == TypeOf<T>::value ? static_cast<T *>(m_data) : nullptr; }
+
+    //Only for script handlers, which can't use the typed payloads
+    QVariant toVariant() const;
+
+    //The payload type bound to each event at run time, for handlers of scripts. See EVENT_PAYLOAD_LIST.
+    static Type typeOf(EventType event);
+
+private:
+    Type m_type;
+    void *m_data;
+};
+
+template<> struct EventData::TypeOf<int> { static const Type value = IntData; };
+template<> struct EventData::TypeOf<QList<CardsMoveStruct>> { static const Type value = CardsMoveData; };
+template<> struct EventData::TypeOf<PhaseChangeStruct> { static const Type value = PhaseChangeData; };
+template<> struct EventData::TypeOf<CardUseStruct> { static const Type value = CardUseData; };
+template<> struct EventData::TypeOf<CardEffectStruct> { static const Type value = CardEffectData; };
+template<> struct EventData::TypeOf<SlashEffectStruct> { static const Type value = SlashEffectData; };
+template<> struct EventData::TypeOf<DamageStruct> { static const Type value = DamageData; };
+
+//Payload type of each event with one. EventPayload and EventData::typeOf() are both generated from this list.
+#define EVENT_PAYLOAD_LIST(X) \
+    X(PhaseChanging, PhaseChangeStruct) \
+    X(PhaseSkipping, PhaseChangeStruct) \
+    X(BeforeCardsMove, QList<CardsMoveStruct>) \
+    X(CardsMove, QList<CardsMoveStruct>) \
+    X(DrawPileReshuffled, int) \
+    X(DrawNCards, int) \
+    X(AfterDrawNCards, int) \
+    X(CountMaxCardNum, int) \
+    X(PreCardUsed, CardUseStruct) \
+    X(CardUsed, CardUseStruct) \
+    X(TargetChoosing, CardUseStruct) \
+    X(TargetConfirming, CardUseStruct) \
+    X(TargetChosen, CardUseStruct) \
+    X(TargetConfirmed, CardUseStruct) \
+    X(CardFinished, CardUseStruct) \
+    X(CardEffect, CardEffectStruct) \
+    X(CardEffected, CardEffectStruct) \
+    X(CardEffectConfirmed, CardEffectStruct) \
+    X(PostCardEffected, CardEffectStruct) \
+    X(TrickCardCanceling, CardEffectStruct) \
+    X(SlashEffect, SlashEffectStruct) \
+    X(SlashEffected, SlashEffectStruct) \
+    X(SlashProceed, SlashEffectStruct) \
+    X(SlashHit, SlashEffectStruct) \
+    X(SlashMissed, SlashEffectStruct) \
+    X(ConfirmDamage, DamageStruct) \
+    X(Predamage, DamageStruct) \
+    X(DamageForseen, DamageStruct) \
+    X(DamageCaused, DamageStruct) \
+    X(DamageInflicted, DamageStruct) \
+    X(PreDamageDone, DamageStruct) \
+    X(DamageDone, DamageStruct) \
+    X(Damage, DamageStruct) \
+    X(Damaged, DamageStruct) \
+    X(DamageComplete, DamageStruct)
+
+//Payload type bound to each event at compile time. Events without a payload are bound to void.
+template<EventType event> struct EventPayload { typedef void Type; };
+
+#define BIND_EVENT_PAYLOAD(event, type) template<> struct EventPayload<event> { typedef type Type; };
+EVENT_PAYLOAD_LIST(BIND_EVENT_PAYLOAD)
+#undef BIND_EVENT_PAYLOAD
+
+#endif // EVENTDATA_H
@@ -44,7 +44,19 @@ bool EventHandler::triggerable(ServerPlayer *owner) const
     return owner != nullptr && owner->isAlive() && owner->hasSkill(this);
 }
 
-QMap<ServerPlayer *, Event> EventHandler::triggerable(GameLogic *logic, EventType event, ServerPlayer *owner, QVariant &data) const
+void EventHandler::triggerable(GameLogic *logic, EventType event, ServerPlayer *owner, EventData &data, EventList &events) const
+{
+    QMap<ServerPlayer *, Event> result = triggerable(logic, event, owner, data);
+    QMapIterator<ServerPlayer *, Event> iter(result);
+    while (iter.hasNext()) {
+        iter.next();
+        Event d = iter.value();
+        d.owner = iter.key();
+        events << d;
+    }
+}
+
+QMap<ServerPlayer *, Event> EventHandler::triggerable(GameLogic *logic, EventType event, ServerPlayer *owner, EventData &data) const
 {
     QMap<ServerPlayer *, Event> result;
     QList<Event> events = triggerable(logic, event, owner, data, owner);
@@ -53,7 +65,7 @@ QMap<ServerPlayer *, Event> EventHandler::triggerable(GameLogic *logic, EventTyp
     return result;
 }
 
-QList<Event> EventHandler::triggerable(GameLogic *logic, EventType event, ServerPlayer *owner, QVariant &data, Player *invoker) const
+QList<Event> EventHandler::triggerable(GameLogic *logic, EventType event, ServerPlayer *owner, EventData &data, Player *invoker) const
 {
     Q_UNUSED(logic)
     Q_UNUSED(event)
@@ -67,7 +79,7 @@ QList<Event> EventHandler::triggerable(GameLogic *logic, EventType event, Server
     return Events;
 }
 
-bool EventHandler::cost(GameLogic *logic, EventType event, ServerPlayer *target, QVariant &data, Player *invoker) const
+bool EventHandler::cost(GameLogic *logic, EventType event, ServerPlayer *target, EventData &data, Player *invoker) const
 {
     Q_UNUSED(logic)
     Q_UNUSED(event)
@@ -77,7 +89,7 @@ bool EventHandler::cost(GameLogic *logic, EventType event, ServerPlayer *target,
     return true;
 }
 
-bool EventHandler::effect(GameLogic *logic, EventType event, ServerPlayer *target, QVariant &data, Player *invoker) const
+bool EventHandler::effect(GameLogic *logic, EventType event, ServerPlayer *target, EventData &data, Player *invoker) const
 {
     Q_UNUSED(logic)
     Q_UNUSED(event)
@@ -22,8 +22,8 @@
 
 #include "eventtype.h"
 #include "event.h"
+#include "eventdata.h"
 
-#include <QVariant>
 #include <QList>
 #include <QMap>
 
@@ -53,10 +53,15 @@ public:
     Frequency frequency() const { return m_frequency; }
 
     virtual bool triggerable(ServerPlayer *owner) const;
-    virtual QMap<ServerPlayer *, Event> triggerable(GameLogic *logic, EventType event, ServerPlayer *owner, QVariant &data) const;
-    virtual QList<Event> triggerable(GameLogic *logic, EventType event, ServerPlayer *owner, QVariant &data, Player *invoker) const;
-    virtual bool cost(GameLogic *logic, EventType event, ServerPlayer *target, QVariant &data, Player *invoker = nullptr) const;
-    virtual bool effect(GameLogic *logic, EventType event, ServerPlayer *target, QVariant &data, Player *invoker = nullptr) const;
+
+    //Appends the triggerable events to the buffer of the current trigger.
+    //The default implementation adapts the map-based overloads below.
+    virtual void triggerable(GameLogic *logic, EventType event, ServerPlayer *owner, EventData &data, EventList &events) const;
+
+    virtual QMap<ServerPlayer *, Event> triggerable(GameLogic *logic, EventType event, ServerPlayer *owner, EventData &data) const;
+    virtual QList<Event> triggerable(GameLogic *logic, EventType event, ServerPlayer *owner, EventData &data, Player *invoker) const;
+    virtual bool cost(GameLogic *logic, EventType event, ServerPlayer *target, EventData &data, Player *invoker = nullptr) const;
+    virtual bool effect(GameLogic *logic, EventType event, ServerPlayer *target, EventData &data, Player *invoker = nullptr) const;
 
 protected:
     QList<EventType> m_events;
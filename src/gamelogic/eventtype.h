@@ -72,6 +72,9 @@ enum EventType
     Damaged,          // the moment for -- yiji..
     DamageComplete,   // the moment for trigger iron chain
 
+    StageChange,
+    DrawPileReshuffled,
+
     EventTypeCount
 };
 
@@ -0,0 +1,235 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+
+#include "gamejournal.h"
+
+#include <cserveragent.h>
+
+#include <QDataStream>
+#include <QFile>
+#include <QMutex>
+#include <QSet>
+#include <QThread>
+#include <QWaitCondition>
+
+static const int StreamVersion = QDataStream::Qt_5_0;
+
+//Files of a journal. They are written and closed on the writer thread.
+struct JournalFiles
+{
+    QFile file;
+    QFile index;
+};
+
+//One low-priority thread writes the journals of all the rooms
+class JournalWriter : public QThread
+{
+public:
+    static JournalWriter *instance()
+    {
+        static JournalWriter writer;
+        return &writer;
+    }
+
+    ~JournalWriter()
+    {
+        m_mutex.lock();
+        m_stopping = true;
+        m_condition.wakeOne();
+        m_mutex.unlock();
+        wait();
+    }
+
+    void enqueue(JournalFiles *files, const QByteArray &record, int turn)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!isRunning() && !m_stopping)
+            start(QThread::LowPriority);
+        m_queue << Chunk(files, record, turn);
+        m_condition.wakeOne();
+    }
+
+    //The files are flushed and deleted once the records queued before are written
+    void close(JournalFiles *files)
+    {
+        enqueue(files, QByteArray(), CloseTurn);
+    }
+
+protected:
+    void run() override
+    {
+        QList<Chunk> chunks;
+        QSet<JournalFiles *> written;
+        forever {
+            m_mutex.lock();
+            while (m_queue.isEmpty() && !m_stopping)
+                m_condition.wait(&m_mutex);
+            chunks.swap(m_queue);
+            bool stopping = m_stopping;
+            m_mutex.unlock();
+
+            foreach (const Chunk &chunk, chunks) {
+                JournalFiles *files = chunk.files;
+                if (chunk.turn == CloseTurn) {
+                    written.remove(files);
+                    delete files;
+                    continue;
+                }
+
+                if (chunk.turn >= 0) {
+                    QDataStream index(&files->index);
+                    index.setVersion(StreamVersion);
+                    index << quint32(chunk.turn) << quint64(files->file.pos());
+                }
+                files->file.write(chunk.record);
+                written.insert(files);
+            }
+            chunks.clear();
+
+            foreach (JournalFiles *files, written) {
+                files->file.flush();
+                files->index.flush();
+            }
+            written.clear();
+
+            if (stopping)
+                return;
+        }
+    }
+
+private:
+    JournalWriter()
+        : m_stopping(false)
+    {
+    }
+
+    enum { CloseTurn = -2 };
+
+    struct Chunk
+    {
+        Chunk(JournalFiles *files, const QByteArray &record, int turn) : files(files), record(record), turn(turn) {}
+
+        JournalFiles *files;
+        QByteArray record;
+        //Turn of a snapshot, -1 for the other records and CloseTurn to close the files
+        int turn;
+    };
+
+    QMutex m_mutex;
+    QWaitCondition m_condition;
+    QList<Chunk> m_queue;
+    bool m_stopping;
+};
+
+GameJournal::GameJournal(const QString &path, int snapshotInterval)
+    : m_files(new JournalFiles)
+    , m_snapshotInterval(qMax(snapshotInterval, 1))
+    , m_turn(-1)
+{
+    //Nothing is queued for the files yet, so the header is written on this thread
+    m_files->file.setFileName(path);
+    m_files->index.setFileName(path + ".index");
+    if (m_files->file.open(QIODevice::WriteOnly | QIODevice::Truncate) && m_files->index.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        m_files->file.write("QSGJ", 4);
+        m_files->file.putChar(char(Version));
+    } else {
+        qWarning("Failed to open the game journal %s", qPrintable(path));
+        delete m_files;
+        m_files = nullptr;
+    }
+    m_timer.start();
+}
+
+GameJournal::~GameJournal()
+{
+    if (m_files)
+        JournalWriter::instance()->close(m_files);
+}
+
+void GameJournal::recordNotification(int command, const QVariant &data, CServerAgent *receiver, CServerAgent *except)
+{
+    recordMessage(NotificationRecord, command, data, receiver, except);
+}
+
+void GameJournal::recordRequest(CServerAgent *agent, int command, const QVariant &data)
+{
+    recordMessage(RequestRecord, command, data, agent, nullptr);
+}
+
+void GameJournal::recordReply(CServerAgent *agent, int command, const QVariant &data)
+{
+    recordMessage(ReplyRecord, command, data, agent, nullptr);
+}
+
+bool GameJournal::beginTurn()
+{
+    m_turn++;
+    return m_turn % m_snapshotInterval == 0;
+}
+
+void GameJournal::recordSnapshot(const QVariant &state)
+{
+    if (m_files == nullptr)
+        return;
+
+    QByteArray body;
+    QDataStream stream(&body, QIODevice::WriteOnly);
+    stream.setVersion(StreamVersion);
+    stream << quint32(qMax(m_turn, 0)) << state;
+    append(SnapshotRecord, body, qMax(m_turn, 0));
+}
+
+void GameJournal::recordSync(uint playerId, const QVariant &state)
+{
+    if (m_files == nullptr)
+        return;
+
+    QByteArray body;
+    QDataStream stream(&body, QIODevice::WriteOnly);
+    stream.setVersion(StreamVersion);
+    stream << quint32(playerId) << state;
+    append(SyncRecord, body);
+}
+
+void GameJournal::recordMessage(RecordType type, int command, const QVariant &data, CServerAgent *receiver, CServerAgent *except)
+{
+    if (m_files == nullptr)
+        return;
+
+    QByteArray body;
+    QDataStream stream(&body, QIODevice::WriteOnly);
+    stream.setVersion(StreamVersion);
+    stream << quint32(receiver ? receiver->id() : 0);
+    stream << quint32(except ? except->id() : 0);
+    stream << qint32(command);
+    stream << data;
+    append(type, body);
+}
+
+void GameJournal::append(RecordType type, const QByteArray &body, int turn)
+{
+    QByteArray record;
+    record.reserve(body.size() + 9);
+    QDataStream stream(&record, QIODevice::WriteOnly);
+    stream.setVersion(StreamVersion);
+    stream << quint32(body.size() + 5) << quint8(type) << quint32(m_timer.elapsed());
+    record.append(body);
+    JournalWriter::instance()->enqueue(m_files, record, turn);
+}
@@ -0,0 +1,86 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+
+#ifndef GAMEJOURNAL_H
+#define GAMEJOURNAL_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QString>
+#include <QVariant>
+
+class CServerAgent;
+struct JournalFiles;
+
+//Append-only record of everything a room sends and receives.
+//Records are encoded on the room thread and written by one low-priority thread shared by all the journals.
+//
+//File layout: the magic "QSGJ" and a version byte, then records of
+//  quint32 size, quint8 type, quint32 msecs since the journal was opened, body (QDataStream)
+//The body of a notification, request or reply is: quint32 receiver, quint32 except, qint32 command, QVariant data.
+//Agent ids are 0 for everyone and no one. A snapshot body is: quint32 turn, QVariant state.
+//A sync body is: quint32 player id, QVariant state, as the agent of a reconnected player is a new one.
+//Turns are counted from 0.
+//
+//Every snapshot appends (quint32 turn, quint64 offset) to the ".index" file next to the journal,
+//so that a viewer can seek to a turn and replay at most one snapshot interval of records.
+class GameJournal
+{
+public:
+    enum RecordType
+    {
+        NotificationRecord = 1,
+        RequestRecord,
+        ReplyRecord,
+        SnapshotRecord,
+        SyncRecord
+    };
+
+    enum { Version = 2 };
+
+    GameJournal(const QString &path, int snapshotInterval = 8);
+    ~GameJournal();
+
+    bool isOpen() const { return m_files != nullptr; }
+
+    void recordNotification(int command, const QVariant &data, CServerAgent *receiver = nullptr, CServerAgent *except = nullptr);
+    void recordRequest(CServerAgent *agent, int command, const QVariant &data);
+    void recordReply(CServerAgent *agent, int command, const QVariant &data);
+    void recordSync(uint playerId, const QVariant &state);
+
+    //Called when a turn starts. Returns true if a snapshot should be recorded now.
+    bool beginTurn();
+    void recordSnapshot(const QVariant &state);
+
+private:
+    Q_DISABLE_COPY(GameJournal)
+
+    void recordMessage(RecordType type, int command, const QVariant &data, CServerAgent *receiver, CServerAgent *except);
+    void append(RecordType type, const QByteArray &body, int turn = -1);
+
+    //Handed over to the writer thread when the journal is destroyed
+    JournalFiles *m_files;
+    QElapsedTimer m_timer;
+    int m_snapshotInterval;
+    //Index of the current turn, -1 before the first one
+    int m_turn;
+};
+
+#endif // GAMEJOURNAL_H
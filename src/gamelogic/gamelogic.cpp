@@ -20,177 +20,229 @@
 #include "card.h"
 #include "cardarea.h"
 #include "eventhandler.h"
+#include "gamejournal.h"
 #include "gamelogic.h"
 #include "gamerule.h"
+#include "logicscheduler.h"
 #include "general.h"
 #include "package.h"
 #include "protocol.h"
 #include "serverplayer.h"
+#include "skill.h"
 #include "util.h"
+#include "wireformat.h"
 
 #include <croom.h>
 #include <cserver.h>
 #include <cserveruser.h>
 #include <cserverrobot.h>
 
-#include <QDateTime>
-#include <QThread>
+#include <QBitArray>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QUuid>
+
+#include <algorithm>
+
+Q_STATIC_ASSERT(EventTypeCount <= 64);
+
+//Set once the missing reply signal of the agents has been reported
+static QAtomicInt ReplySignalWarned;
 
 GameLogic::GameLogic(CRoom *parent)
     : CAbstractGameLogic(parent)
+    , m_aliveSeats(1)
+    , m_liveEvents(0)
+    , m_dispatchedTriggerNum(0)
+    , m_skippedTriggerNum(0)
+    , m_moveNum(0)
+    , m_interruption(InvalidEvent)
     , m_currentPlayer(nullptr)
     , m_gameRule(nullptr)
     , m_skipGameRule(false)
+    , m_requestTimeout(15000)
     , m_round(0)
+    , m_reshuffleNum(0)
+    , m_fastForward(0)
+    , m_random(RandomGenerator::makeSeed())
+    , m_journal(nullptr)
+    , m_scheduler(nullptr)
+    , m_task(nullptr)
+    , m_spawned(0)
+    , m_syncPending(0)
 {
     m_drawPile = new CardArea(CardArea::DrawPile);
+    m_drawPile->setCardTable(&m_cardTable);
     m_discardPile = new CardArea(CardArea::DiscardPile);
+    m_discardPile->setCardTable(&m_cardTable);
     m_table = new CardArea(CardArea::Table);
+    m_table->setCardTable(&m_cardTable);
+
+    if (parent)
+        connect(parent, &CRoom::userAdded, this, &GameLogic::onUserAdded);
 }
 
 GameLogic::~GameLogic()
 {
+    delete m_journal;
     delete m_drawPile;
-
-    foreach (Card *card, m_cards)
-        delete card;
 }
 
 void GameLogic::setGameRule(const GameRule *rule) {
     if (m_gameRule) {
-        foreach (EventType e, m_gameRule->events()) {
-            if (m_handlers[e].contains(m_gameRule))
-                m_handlers[e].removeOne(m_gameRule);
-        }
+        foreach (EventType e, m_gameRule->events())
+            removeHandler(e, m_gameRule);
     }
 
     m_gameRule = rule;
     if (rule) {
         foreach (EventType e, rule->events())
-            m_handlers[e].append(m_gameRule);
+            insertHandler(e, m_gameRule);
     }
+
+    updateLiveEvents();
 }
 
 void GameLogic::addEventHandler(const EventHandler *handler)
 {
     QList<EventType> events = handler->events();
     foreach(EventType event, events)
-        m_handlers[event] << handler;
+        insertHandler(event, handler);
+
+    updateLiveEvents();
+}
+
+bool GameLogic::skipTrigger(EventType event, int targetNum)
+{
+    if (hasLiveHandler(event))
+        return false;
+
+    //Interrupted triggers return before they are counted
+    if (!isInterrupted())
+        m_skippedTriggerNum += targetNum;
+    return true;
 }
 
 bool GameLogic::trigger(EventType event, ServerPlayer *target)
 {
-    QVariant data;
+    if (isInterrupted())
+        return true;
+
+    if (skipTrigger(event))
+        return false;
+
+    EventData data;
     return trigger(event, target, data);
 }
 
-bool GameLogic::trigger(EventType event, ServerPlayer *target, QVariant &data)
+bool GameLogic::trigger(EventType event, ServerPlayer *target, EventData &data)
 {
-    QList<const EventHandler *> &handlers = m_handlers[event];
+    if (isInterrupted())
+        return true;
 
-    //@todo: Resolve C++98 Incompatibility?
-    qStableSort(handlers.begin(), handlers.end(), [event](const EventHandler *a, const EventHandler *b){
-        return a->priority(event) > b->priority(event);
-    });
+    if (!data.isNull() && data.type() != EventData::typeOf(event)) {
+        qWarning("GameLogic::trigger: the payload of event %d doesn't match it", event);
+        return false;
+    }
+
+    if (skipTrigger(event))
+        return false;
+    m_dispatchedTriggerNum++;
+
+    //Copy the buckets as handlers might be added or removed by the effects
+    const QList<HandlerBucket> buckets = m_handlers[event];
 
     bool broken = false;
-    int triggerableIndex = 0;
-    while (triggerableIndex < handlers.length()) {
-        int currentPriority = 0;
-        QMap<ServerPlayer *, QList<Event>> triggerableEvents;
+    foreach (const HandlerBucket &bucket, buckets) {
+        EventList triggerableEvents;
 
         //Construct triggerableEvents
-        do {
-            const EventHandler *handler = handlers.at(triggerableIndex);
-            if (triggerableEvents.isEmpty() || handler->priority(event) == currentPriority) {
-                QMap<ServerPlayer *, Event> events = handler->triggerable(this, event, target, data);
-                QList<ServerPlayer *> players = this->players();
-                foreach (ServerPlayer *p, players) {
-                    if (!events.contains(p))
-                        continue;
+        foreach (const HandlerEntry &entry, bucket.handlers) {
+            //Skip skills that no alive player owns
+            if ((entry.owners & m_aliveSeats) == 0)
+                continue;
 
-                    QList<Event> ds = events.values(p);
-                    triggerableEvents[p] << ds;
-                    currentPriority = ds.last().handler->priority(event);
-                }
-            } else if (handler->priority(event) != currentPriority) {
-                break;
-            }
-            triggerableIndex++;
-        } while (triggerableIndex < handlers.length());
-
-        if (!triggerableEvents.isEmpty()) {
-            QList<ServerPlayer *> allPlayers = this->allPlayers(true);
-            foreach (ServerPlayer *invoker, allPlayers) {
-                if (!triggerableEvents.contains(invoker))
-                    continue;
-
-                forever {
-                    QList<Event> &events = triggerableEvents[invoker];
-                    if (events.isEmpty())
-                        break;
+            entry.handler->triggerable(this, event, target, data, triggerableEvents);
+        }
 
-                    bool hasCompulsory = false;
-                    foreach (const Event &d, events) {
-                        if (d.handler->frequency() == EventHandler::Compulsory || d.handler->frequency() == EventHandler::Wake) {
-                            hasCompulsory = true;
-                            break;
-                        }
-                    }
+        if (triggerableEvents.isEmpty())
+            continue;
 
-                    //Ask the invoker to determine the trigger order
-                    Event choice;
-                    if (events.length() > 1) {
-                        if (!invoker->hasShownBothGenerals())
-                            m_globalRequestEnabled = true;
-                        choice = invoker->askForTriggerOrder("GameRule:TriggerOrder", events, !hasCompulsory);
-                        m_globalRequestEnabled = false;
-                    } else {
-                        choice = events.first();
-                    }
+        foreach (ServerPlayer *invoker, actionOrder(true)) {
+            if (!triggerableEvents.hasOwner(invoker))
+                continue;
 
-                    //If the user selects "cancel"
-                    if (!choice.isValid())
+            EventList events = triggerableEvents.eventsOf(invoker);
+            forever {
+                if (events.isEmpty())
+                    break;
+
+                bool hasCompulsory = false;
+                for (int i = 0; i < events.length(); i++) {
+                    const EventHandler *handler = events.at(i).handler;
+                    if (handler->frequency() == EventHandler::Compulsory || handler->frequency() == EventHandler::Wake) {
+                        hasCompulsory = true;
                         break;
+                    }
+                }
 
-                    ServerPlayer *eventTarget = choice.to.isEmpty() ? target : choice.to.first();
-
-                    //Ask the invoker for cost
-                    if (!invoker->hasShownSkill(choice.handler))
+                //Ask the invoker to determine the trigger order
+                Event choice;
+                if (events.length() > 1) {
+                    if (!invoker->hasShownBothGenerals())
                         m_globalRequestEnabled = true;
-                    bool takeEffect = choice.handler->cost(this, event, eventTarget, data, invoker);
-                    if (takeEffect && !invoker->hasShownSkill(choice.handler)) {
-                        //@todo: show skill here?
-                    }
+                    choice = invoker->askForTriggerOrder("GameRule:TriggerOrder", events, !hasCompulsory);
                     m_globalRequestEnabled = false;
+                } else {
+                    choice = events.first();
+                }
 
-                    //Take effect
-                    if (takeEffect) {
-                        broken = choice.handler->effect(this, event, eventTarget, data, invoker);
-                        if (broken)
-                            break;
-                    }
+                //If the user selects "cancel"
+                if (!choice.isValid())
+                    break;
 
-                    //Remove targets that are in front of the triggered target
-                    for (int i = 0; i < events.length(); i++) {
-                        Event &d = events[i];
-                        if (d.handler != choice.handler)
-                            continue;
-
-                        foreach (ServerPlayer *to, choice.to) {
-                            int index = d.to.indexOf(to);
-                            if (index == d.to.length() - 1) {
-                                events.removeAt(i);
-                                i--;
-                            } else {
-                                d.to = d.to.mid(index + 1);
-                            }
-                        }
+                ServerPlayer *eventTarget = choice.to.isEmpty() ? target : choice.to.first();
+
+                //Ask the invoker for cost
+                if (!invoker->hasShownSkill(choice.handler))
+                    m_globalRequestEnabled = true;
+                bool takeEffect = choice.handler->cost(this, event, eventTarget, data, invoker);
+                if (takeEffect && !invoker->hasShownSkill(choice.handler)) {
+                    //@todo: show skill here?
+                }
+                m_globalRequestEnabled = false;
+                if (isInterrupted())
+                    return true;
+
+                //Take effect
+                if (takeEffect) {
+                    broken = choice.handler->effect(this, event, eventTarget, data, invoker);
+                    if (isInterrupted())
+                        return true;
+                    if (broken)
+                        break;
+                }
 
-                        if (choice.to.isEmpty()) {
-                            events.removeAt(i);
-                            i--;
+                //Remove targets that are in front of the triggered target
+                for (int i = 0; i < events.length(); i++) {
+                    Event &d = events[i];
+                    if (d.handler != choice.handler)
+                        continue;
+
+                    bool finished = choice.to.isEmpty();
+                    foreach (ServerPlayer *to, choice.to) {
+                        int index = d.to.indexOf(to);
+                        if (index == d.to.size() - 1) {
+                            finished = true;
+                            break;
                         }
+                        d.to.remove(0, index + 1);
+                    }
+
+                    if (finished) {
+                        events.removeAt(i);
+                        i--;
                     }
                 }
             }
@@ -200,6 +252,41 @@ bool GameLogic::trigger(EventType event, ServerPlayer *target, QVariant &data)
     return broken;
 }
 
+void GameLogic::interrupt(EventType reason)
+{
+    //The game finishing overrides a broken turn
+    if (m_interruption == InvalidEvent || reason == GameFinish)
+        m_interruption = reason;
+}
+
+void GameLogic::acquireSkill(ServerPlayer *player, const Skill *skill)
+{
+    player->addSkill(skill);
+
+    const TriggerSkill *triggerSkill = qobject_cast<const TriggerSkill *>(skill);
+    if (triggerSkill) {
+        QList<EventType> events = triggerSkill->events();
+        foreach (EventType event, events)
+            insertHandler(event, triggerSkill, player->seat());
+    }
+
+    updateLiveEvents();
+}
+
+void GameLogic::detachSkill(ServerPlayer *player, const Skill *skill)
+{
+    player->removeSkill(skill);
+
+    const TriggerSkill *triggerSkill = qobject_cast<const TriggerSkill *>(skill);
+    if (triggerSkill) {
+        QList<EventType> events = triggerSkill->events();
+        foreach (EventType event, events)
+            removeHandler(event, triggerSkill, player->seat());
+    }
+
+    updateLiveEvents();
+}
+
 QList<ServerPlayer *> GameLogic::players() const
 {
     QList<ServerPlayer *> players;
@@ -216,57 +303,108 @@ ServerPlayer *GameLogic::findPlayer(uint id) const
 
 ServerPlayer *GameLogic::findPlayer(CServerAgent *agent) const
 {
-    return qobject_cast<ServerPlayer *>(findAbstractPlayer(agent));
+    ServerPlayer *player = qobject_cast<ServerPlayer *>(findAbstractPlayer(agent));
+    if (player && player->agent() == agent)
+        return player;
+
+    //CAbstractGameLogic doesn't know the agents of reconnected clients
+    QList<ServerPlayer *> players = this->players();
+    foreach (player, players) {
+        if (player->agent() == agent)
+            return player;
+    }
+    return nullptr;
 }
 
-QList<ServerPlayer *> GameLogic::allPlayers(bool includeDead) const
+PlayerRing::Range<ServerPlayer> GameLogic::actionOrder(bool includeDead) const
 {
-    QList<ServerPlayer *> players = this->players();
-    ServerPlayer *current = currentPlayer();
-    if (current == nullptr)
-        return players;
+    quint32 mask = includeDead ? m_ring.seats() : m_ring.aliveSeats();
+    return m_ring.players<ServerPlayer>(actionStartSeat(), mask);
+}
 
-    int currentIndex = players.indexOf(current);
-    if (currentIndex == -1)
-        return players;
+int GameLogic::actionStartSeat() const
+{
+    ServerPlayer *current = currentPlayer();
+    if (current == nullptr || m_ring.length() <= 0)
+        return 1;
 
-    QList<ServerPlayer *> allPlayers;
-    for (int i = currentIndex; i < players.length(); i++) {
-        if (includeDead || players.at(i)->isAlive())
-            allPlayers << players.at(i);
-    }
-    for (int i = 0; i < currentIndex; i++) {
-        if (includeDead || players.at(i)->isAlive())
-            allPlayers << players.at(i);
-    }
+    //The current player acts last when it's not in its turn
+    if (current->phase() == Player::NotActive)
+        return current->seat() % m_ring.length() + 1;
+    return current->seat();
+}
 
-    if (current->phase() == Player::NotActive && allPlayers.contains(current)) {
-        allPlayers.removeOne(current);
-        allPlayers.append(current);
-    }
+QList<ServerPlayer *> GameLogic::allPlayers(bool includeDead) const
+{
+    if (m_ring.length() <= 0)
+        return players();
 
+    QList<ServerPlayer *> allPlayers;
+    allPlayers.reserve(m_ring.length());
+    foreach (ServerPlayer *player, actionOrder(includeDead))
+        allPlayers << player;
     return allPlayers;
 }
 
 QList<ServerPlayer *> GameLogic::otherPlayers(ServerPlayer *except, bool includeDead) const
 {
-    QList<ServerPlayer *> players = allPlayers(includeDead);
-    if (except && (except->isAlive() || includeDead))
-        players.removeOne(except);
+    QList<ServerPlayer *> players;
+    players.reserve(m_ring.length());
+    foreach (ServerPlayer *player, actionOrder(includeDead)) {
+        if (player != except)
+            players << player;
+    }
     return players;
 }
 
 void GameLogic::sortByActionOrder(QList<ServerPlayer *> &players) const
 {
-    QList<ServerPlayer *> allPlayers = this->allPlayers(true);
+    int seatNum = m_ring.length();
+    if (players.length() <= 1 || seatNum <= 0)
+        return;
 
-    QMap<ServerPlayer *, int> actionOrder;
-    foreach (ServerPlayer *player, players)
-        actionOrder[player] = allPlayers.indexOf(player);
+    //Seat distance from the first player to act
+    int startSeat = actionStartSeat();
+    auto lessThan = [startSeat, seatNum](const ServerPlayer *a, const ServerPlayer *b) {
+        return (a->seat() - startSeat + seatNum) % seatNum < (b->seat() - startSeat + seatNum) % seatNum;
+    };
 
-    qSort(allPlayers.begin(), allPlayers.end(), [&actionOrder](ServerPlayer *a, ServerPlayer *b){
-        return actionOrder.value(a) < actionOrder.value(b);
-    });
+    //Lists built from actionOrder(), such as the targets of AoE cards, are already sorted
+    if (std::is_sorted(players.constBegin(), players.constEnd(), lessThan))
+        return;
+
+    std::sort(players.begin(), players.end(), lessThan);
+}
+
+QList<const Card *> GameLogic::getDrawPileCards(int n)
+{
+    if (m_drawPile->length() < n)
+        reshuffleDrawPile();
+    return m_drawPile->first(n);
+}
+
+void GameLogic::reshuffleDrawPile()
+{
+    if (m_discardPile->length() <= 0) {
+        //No cards left at all, the game ends in a draw
+        if (m_drawPile->length() <= 0)
+            interrupt(GameFinish);
+        return;
+    }
+
+    //One hidden move, so that the clients and the handlers of card moves see it like any other.
+    //Cards are added in the shuffled order under the remaining cards.
+    CardsMoveStruct move;
+    move.from.type = CardArea::DiscardPile;
+    move.to.type = CardArea::DrawPile;
+    move.cards = m_discardPile->first(m_discardPile->length());
+    qShuffle(move.cards, m_random);
+    move.isOpen = false;
+    moveCards(move);
+
+    m_reshuffleNum++;
+    int reshuffleNum = m_reshuffleNum;
+    trigger<DrawPileReshuffled>(currentPlayer(), reshuffleNum);
 }
 
 void GameLogic::moveCards(const CardsMoveStruct &move)
@@ -282,15 +420,15 @@ void GameLogic::moveCards(QList<CardsMoveStruct> moves)
         if (move.from.type != CardArea::Unknown)
             continue;
 
-        QMap<CardArea *, QList<Card *>> cardSource;
-        foreach (Card *card, move.cards) {
-            CardArea *from = m_cardPosition[card];
+        QMap<CardArea *, QList<const Card *>> cardSource;
+        foreach (const Card *card, move.cards) {
+            CardArea *from = m_cardTable.area(card);
             if (from == nullptr)
                 continue;
             cardSource[from].append(card);
         }
 
-        QMapIterator<CardArea *, QList<Card *>> iter(cardSource);
+        QMapIterator<CardArea *, QList<const Card *>> iter(cardSource);
         while (iter.hasNext()) {
             iter.next();
             CardArea *from = iter.key();
@@ -309,11 +447,13 @@ void GameLogic::moveCards(QList<CardsMoveStruct> moves)
         maxi--;
     }
 
-    QList<ServerPlayer *> allPlayers = this->allPlayers();
-    QVariant moveData = QVariant::fromValue(&moves);
-    foreach (ServerPlayer *player, allPlayers)
-        trigger(BeforeCardsMove, player, moveData);
+    if (!skipTrigger(BeforeCardsMove, qPopulationCount(m_ring.aliveSeats()))) {
+        foreach (ServerPlayer *player, actionOrder())
+            trigger<BeforeCardsMove>(player, moves);
+    }
 
+    //Each area notifies its change once all the moves are done
+    CardMoveTransaction transaction;
     for (int i = 0 ; i < moves.length(); i++) {
         const CardsMoveStruct &move = moves.at(i);
         CardArea *from = findArea(move.from);
@@ -321,28 +461,112 @@ void GameLogic::moveCards(QList<CardsMoveStruct> moves)
         if (from == nullptr || to == nullptr)
             continue;
 
-        foreach (Card *card, move.cards) {
-            if (from != m_cardPosition.value(card))
-                continue;
-            if (from->remove(card)) {
-                to->add(card, move.to.direction);
-                m_cardPosition[card] = to;
-            }
+        transaction.add(from);
+        transaction.add(to);
+
+        QList<const Card *> cards;
+        cards.reserve(move.cards.length());
+        foreach (const Card *card, move.cards) {
+            if (from == m_cardTable.area(card))
+                cards << card;
         }
+        from->remove(cards);
+        to->add(cards, move.to.direction);
     }
+    transaction.commit();
+    m_moveNum += moves.length();
 
-    QList<ServerPlayer *> viewers = players();
-    foreach (ServerPlayer *viewer, viewers) {
-        QVariantList data;
+    notifyMoves(moves);
+
+    if (!skipTrigger(CardsMove, qPopulationCount(m_ring.aliveSeats()))) {
+        foreach (ServerPlayer *player, actionOrder())
+            trigger<CardsMove>(player, moves);
+    }
+}
+
+static QByteArray EncodeMove(const CardsMoveStruct &move, bool open)
+{
+    WireWriter writer;
+    move.encode(writer, open);
+    return writer.body();
+}
+
+void GameLogic::notifyMoves(const QList<CardsMoveStruct> &moves)
+{
+    flushPropertyChanges();
+
+    //Every move is encoded once for the public and at most once more for the players it is open to.
+    //Viewers share the public encoding unless a hidden move is relevant to them.
+    QVariantList publicData;
+    publicData.reserve(moves.length());
+    foreach (const CardsMoveStruct &move, moves)
+        publicData << move.toVariant();
+
+    //The journal keeps every card visible and leaves hiding them to the viewer
+    if (m_journal) {
+        QVariantList journalData;
         foreach (const CardsMoveStruct &move, moves)
-            data << move.toVariant(move.isRelevant(viewer));
-        CServerAgent *agent = viewer->agent();
-        agent->notify(S_COMMAND_MOVE_CARDS, data);
+            journalData << move.toVariant(true);
+        m_journal->recordNotification(S_COMMAND_MOVE_CARDS, journalData);
     }
+    QVector<QVariant> openData(moves.length());
+
+    QVector<QByteArray> publicBinary;
+    QVector<QByteArray> openBinary;
+    QVariant publicBinaryData;
+
+    QList<CServerAgent *> agents = room()->agents();
+    foreach (CServerAgent *agent, agents) {
+        ServerPlayer *viewer = findPlayer(agent);
+
+        QVarLengthArray<int, 8> openMoves;
+        if (viewer) {
+            for (int i = 0; i < moves.length(); i++) {
+                const CardsMoveStruct &move = moves.at(i);
+                if (!move.isOpen && move.isRelevant(viewer))
+                    openMoves.append(i);
+            }
+        }
+
+        if (viewer && viewer->protocolVersion() == WireWriter::Version) {
+            if (publicBinary.isEmpty()) {
+                publicBinary.resize(moves.length());
+                openBinary.resize(moves.length());
+                WireWriter writer;
+                writer.writeVarint(moves.length());
+                for (int i = 0; i < moves.length(); i++) {
+                    publicBinary[i] = EncodeMove(moves.at(i), false);
+                    writer.writeRaw(publicBinary.at(i));
+                }
+                publicBinaryData = writer.toVariant();
+            }
 
-    allPlayers = this->allPlayers();
-    foreach (ServerPlayer *player, allPlayers)
-        trigger(CardsMove, player, moveData);
+            if (openMoves.isEmpty()) {
+                agent->notify(S_COMMAND_MOVE_CARDS, publicBinaryData);
+            } else {
+                WireWriter writer;
+                writer.writeVarint(moves.length());
+                for (int i = 0; i < moves.length(); i++) {
+                    if (openMoves.contains(i)) {
+                        if (openBinary.at(i).isEmpty())
+                            openBinary[i] = EncodeMove(moves.at(i), true);
+                        writer.writeRaw(openBinary.at(i));
+                    } else {
+                        writer.writeRaw(publicBinary.at(i));
+                    }
+                }
+                agent->notify(S_COMMAND_MOVE_CARDS, writer.toVariant());
+            }
+        } else {
+            QVariantList data = publicData;
+            foreach (int i, openMoves) {
+                if (!openData.at(i).isValid())
+                    openData[i] = moves.at(i).toVariant(true);
+                data[i] = openData.at(i);
+            }
+            agent->notify(S_COMMAND_MOVE_CARDS, data);
+        }
+    }
 }
 
 bool GameLogic::useCard(CardUseStruct &use)
@@ -352,9 +576,9 @@ bool GameLogic::useCard(CardUseStruct &use)
 
     //Initialize isHandcard
     use.isHandcard = true;
-    QList<Card *> realCards = use.card->realCards();
-    foreach (Card *card, realCards) {
-        CardArea *area = m_cardPosition[card];
+    QList<const Card *> realCards = use.card->realCards();
+    foreach (const Card *card, realCards) {
+        CardArea *area = m_cardTable.area(card);
         if (area == nullptr || area->owner() != use.from || area->type() != CardArea::Hand) {
             use.isHandcard = false;
             break;
@@ -362,47 +586,43 @@ bool GameLogic::useCard(CardUseStruct &use)
     }
 
     if (use.from->phase() == Player::Play && use.addHistory)
-        use.from->addCardHistory(use.card->objectName());
+        use.from->addCardHistory(use.card->nameId());
 
-    try {
-        use.card->onUse(this, use);
+    use.card->onUse(this, use);
+    if (isInterrupted())
+        return false;
 
-        QVariant data = QVariant::fromValue(&use);
-        trigger(CardUsed, use.from, data);
+    trigger<CardUsed>(use.from, use);
 
-        if (use.from)
-            trigger(TargetChoosing, use.from, data);
+    if (use.from)
+        trigger<TargetChoosing>(use.from, use);
 
-        if (use.from && !use.to.isEmpty()) {
-            foreach (ServerPlayer *to, use.to) {
-                if (!use.to.contains(to))
-                    continue;
+    if (use.from && !use.to.isEmpty()) {
+        foreach (ServerPlayer *to, use.to) {
+            if (isInterrupted())
+                return false;
+            if (!use.to.contains(to))
+                continue;
 
-                trigger(TargetConfirming, to, data);
-            }
+            trigger<TargetConfirming>(to, use);
         }
-
-        trigger(CardFinished, use.from, data);
-
-    } catch (EventType e) {
-        //@to-do: handle TurnBroken and StageChange
-        throw e;
     }
 
-    return true;
+    trigger<CardFinished>(use.from, use);
+
+    return !isInterrupted();
 }
 
 bool GameLogic::takeCardEffect(CardEffectStruct &effect)
 {
-    QVariant data = QVariant::fromValue(&effect);
     bool canceled = false;
     if (effect.to->isAlive()) {
         // No skills should be triggered here!
-        trigger(CardEffect, effect.to, data);
+        trigger<CardEffect>(effect.to, effect);
         // Make sure that effectiveness of Slash isn't judged here!
-        canceled = !trigger(CardEffected, effect.to, data);
+        canceled = !trigger<CardEffected>(effect.to, effect);
     }
-    trigger(PostCardEffected, effect.to, data);
+    trigger<PostCardEffected>(effect.to, effect);
     return canceled;
 }
 
@@ -411,72 +631,638 @@ void GameLogic::damage(DamageStruct &damage)
     if (damage.to == NULL || damage.to->isDead())
         return;
 
-    QVariant data = QVariant::fromValue(&damage);
     if (!damage.chain && !damage.transfer) {
-        trigger(ConfirmDamage, damage.from, data);
+        trigger<ConfirmDamage>(damage.from, damage);
     }
 
     // Predamage
-    if (trigger(Predamage, damage.from, data))
+    if (trigger<Predamage>(damage.from, damage))
         return;
 
-    try {
-        do {
-            if (trigger(DamageForseen, damage.to, data))
-                break;
+    do {
+        if (trigger<DamageForseen>(damage.to, damage))
+            break;
+
+        if (damage.from && trigger<DamageCaused>(damage.from, damage))
+            break;
 
-            if (damage.from && trigger(DamageCaused, damage.from, data))
+        if (damage.to && trigger<DamageInflicted>(damage.to, damage))
+            break;
+    } while (false);
+
+    if (isInterrupted())
+        return;
+
+    if (damage.to)
+        trigger<PreDamageDone>(damage.to, damage);
+
+    if (damage.to && !trigger<DamageDone>(damage.to, damage)) {
+        QVariantList arg;
+        arg << damage.to->id();
+        arg << damage.nature;
+        arg << -damage.damage;
+        WireWriter writer;
+        writer.writeVarint(damage.to->id());
+        writer.writeByte(damage.nature);
+        writer.writeSignedVarint(-damage.damage);
+        broadcastNotification(S_COMMAND_DAMAGE, arg, writer.toVariant());
+
+        int newHp = damage.to->hp() - damage.damage;
+        damage.to->setHp(newHp);
+        damage.to->broadcastProperty(Player::HpProperty);
+    }
+
+    if (damage.from)
+        trigger<Damage>(damage.from, damage);
+
+    if (damage.to)
+        trigger<Damaged>(damage.to, damage);
+
+    if (damage.to)
+        trigger<DamageComplete>(damage.to, damage);
+}
+
+void GameLogic::negotiateProtocol(const QList<ServerPlayer *> &players)
+{
+    //Clients that don't know the command never reply, so they aren't waited for long
+    int timeout = qMin(m_requestTimeout, int(NegotiationTimeout));
+    QVariant data = int(WireWriter::Version);
+
+    QList<ServerPlayer *> clients;
+    foreach (ServerPlayer *player, players) {
+        CServerAgent *agent = player->agent();
+        if (agent == nullptr || !agent->controlledByClient())
+            continue;
+        if (m_journal)
+            m_journal->recordRequest(agent, S_COMMAND_NEGOTIATE_PROTOCOL, data);
+        agent->request(S_COMMAND_NEGOTIATE_PROTOCOL, data, timeout);
+        clients << player;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    foreach (ServerPlayer *player, clients) {
+        CServerAgent *agent = player->agent();
+        if (agent == nullptr)
+            continue;
+        QVariant reply = waitForReply(agent, qMax(timeout - int(timer.elapsed()), 0));
+        if (m_journal)
+            m_journal->recordReply(agent, S_COMMAND_NEGOTIATE_PROTOCOL, reply);
+        //The client replies with the version it supports. Legacy clients get 0.
+        player->setProtocolVersion(reply.toInt());
+    }
+}
+
+bool GameLogic::isBinaryProtocolEnabled(CServerAgent *agent) const
+{
+    ServerPlayer *player = findPlayer(agent);
+    return player && player->protocolVersion() == WireWriter::Version;
+}
+
+void GameLogic::notify(CServerAgent *agent, int command, const QVariant &data, const QVariant &binaryData)
+{
+    flushPropertyChanges();
+    if (m_journal)
+        m_journal->recordNotification(command, data, agent);
+    agent->notify(command, isBinaryProtocolEnabled(agent) ? binaryData : data);
+}
+
+void GameLogic::broadcastNotification(int command, const QVariant &data, const QVariant &binaryData, CServerAgent *except)
+{
+    flushPropertyChanges();
+    if (m_journal)
+        m_journal->recordNotification(command, data, nullptr, except);
+
+    QList<CServerAgent *> agents = room()->agents();
+    foreach (CServerAgent *agent, agents) {
+        if (agent != except)
+            agent->notify(command, isBinaryProtocolEnabled(agent) ? binaryData : data);
+    }
+}
+
+void GameLogic::addPropertyChange(const ServerPlayer *player, Player::Property property, const QVariant &value, CServerAgent *receiver, CServerAgent *except)
+{
+    PropertyChange change;
+    change.playerId = player->id();
+    change.property = property;
+    change.value = value;
+    change.receiver = receiver;
+    change.except = except;
+    m_propertyChanges << change;
+}
+
+void GameLogic::flushPropertyChanges()
+{
+    syncStates();
+
+    if (m_propertyChanges.isEmpty())
+        return;
+
+    QList<PropertyChange> changes;
+    changes.swap(m_propertyChanges);
+
+    if (m_journal) {
+        foreach (const PropertyChange &change, changes) {
+            QVariantList data;
+            data << change.playerId;
+            data << Player::propertyName(change.property);
+            data << change.value;
+            m_journal->recordNotification(S_COMMAND_UPDATE_PLAYER_PROPERTY, data, change.receiver, change.except);
+        }
+    }
+
+    QList<CServerAgent *> agents = room()->agents();
+    QList<ServerPlayer *> players = this->players();
+    int agentNum = agents.length();
+
+    //Bit n of a mask stands for agents.at(n), so rooms of any size are covered. From the newest change to the oldest,
+    //each change keeps only the agents that haven't seen a newer value of the same property, so only the latest values are sent.
+    QVector<QBitArray> masks(changes.length());
+    QVector<QBitArray> covered(players.length() * Player::PropertyCount, QBitArray(agentNum));
+    for (int i = changes.length() - 1; i >= 0; i--) {
+        const PropertyChange &change = changes.at(i);
+        QBitArray mask(agentNum, change.receiver == nullptr);
+        if (change.receiver) {
+            int index = agents.indexOf(change.receiver);
+            if (index >= 0)
+                mask.setBit(index);
+        } else if (change.except) {
+            int index = agents.indexOf(change.except);
+            if (index >= 0)
+                mask.clearBit(index);
+        }
+
+        int slot = -1;
+        for (int j = 0; j < players.length(); j++) {
+            if (players.at(j)->id() == change.playerId) {
+                slot = j * Player::PropertyCount + change.property;
                 break;
+            }
+        }
+        if (slot >= 0) {
+            QBitArray seen = covered.at(slot);
+            covered[slot] |= mask;
+            mask &= ~seen;
+        }
+        masks[i] = mask;
+    }
+
+    //Agents usually see the same changes, so the last binary message is reused if nothing differs
+    QVarLengthArray<int, 32> lastVisible;
+    QVariant lastBinaryData;
+
+    for (int agentIndex = 0; agentIndex < agentNum; agentIndex++) {
+        CServerAgent *agent = agents.at(agentIndex);
+        QVarLengthArray<int, 32> visible;
+        for (int i = 0; i < changes.length(); i++) {
+            if (masks.at(i).testBit(agentIndex))
+                visible.append(i);
+        }
+
+        if (visible.isEmpty())
+            continue;
+
+        if (isBinaryProtocolEnabled(agent)) {
+            if (lastBinaryData.isNull() || visible != lastVisible) {
+                WireWriter writer;
+                writer.writeVarint(visible.size());
+                foreach (int i, visible) {
+                    const PropertyChange &change = changes.at(i);
+                    writer.writeVarint(change.playerId);
+                    writer.writeVarint(change.property);
+                    writer.writeVariant(change.value);
+                }
+                lastBinaryData = writer.toVariant();
+                lastVisible = visible;
+            }
+            agent->notify(S_COMMAND_UPDATE_PLAYER_PROPERTY, lastBinaryData);
+        } else {
+            //Clients of the map-based format only understand one property per message
+            foreach (int i, visible) {
+                const PropertyChange &change = changes.at(i);
+                QVariantList data;
+                data << change.playerId;
+                data << Player::propertyName(change.property);
+                data << change.value;
+                agent->notify(S_COMMAND_UPDATE_PLAYER_PROPERTY, data);
+            }
+        }
+    }
+}
+
+void GameLogic::delay(ulong msecs)
+{
+    if (isFastForward())
+        return;
+
+    bool watched = false;
+    QList<CServerAgent *> agents = room()->agents();
+    foreach (CServerAgent *agent, agents) {
+        if (agent->controlledByClient()) {
+            watched = true;
+            break;
+        }
+    }
+    if (!watched)
+        return;
 
-            if (damage.to && trigger(DamageInflicted, damage.to, data))
+    //Clients should see the changes before the pause rather than after it
+    flushPropertyChanges();
+
+    if (m_task) {
+        m_task->sleep(msecs);
+        if (m_task->isCancelled())
+            interrupt(GameFinish);
+    } else {
+        //Waiting on the condition instead of sleeping lets setFastForward() end the delay
+        QMutexLocker locker(&m_delayMutex);
+        if (!isFastForward())
+            m_delayCondition.wait(&m_delayMutex, msecs);
+    }
+}
+
+void GameLogic::setFastForward(bool enabled)
+{
+    QMutexLocker locker(&m_delayMutex);
+    m_fastForward.store(enabled ? 1 : 0);
+    if (enabled) {
+        m_delayCondition.wakeAll();
+        if (m_task)
+            m_task->wake();
+    }
+}
+
+QVariant GameLogic::waitForReply(CServerAgent *agent, int timeout)
+{
+    QPointer<CServerAgent> guard(agent);
+    //Users asked for a reconnect token have no player yet
+    bool seated = findPlayer(agent) != nullptr;
+    QElapsedTimer timer;
+    timer.start();
+    QVariant reply;
+
+    if (m_task == nullptr || !Coroutine::isSupported()) {
+        //A blocked thread can't be woken up, so it looks for reconnected clients between slices of the wait
+        forever {
+            int remaining = timeout - int(timer.elapsed());
+            reply = agent->waitForReply(qMin(remaining, int(SyncCheckInterval)));
+            if (!reply.isNull() || remaining <= SyncCheckInterval || guard.isNull())
+                break;
+            syncStates();
+            if (seated && findPlayer(agent) == nullptr)
                 break;
-        } while (false);
+        }
+        return reply;
+    }
+
+    //The coroutine is suspended so that the worker runs other rooms meanwhile, and resumed once the reply arrives.
+    //Agents without the signal are polled.
+    QMetaObject::Connection connection = m_task->wakeOn(agent, "replyReady()");
+    if (!connection && !ReplySignalWarned.fetchAndStoreRelaxed(1))
+        qWarning("%s has no replyReady() signal. Replies are polled every %d ms.", agent->metaObject()->className(), int(ReplyPollInterval));
+    forever {
+        if (m_task->isCancelled()) {
+            interrupt(GameFinish);
+            break;
+        }
+
+        reply = agent->waitForReply(0);
+        int remaining = timeout - int(timer.elapsed());
+        if (!reply.isNull() || remaining <= 0)
+            break;
+
+        m_task->sleep(connection ? remaining : qMin(remaining, int(ReplyPollInterval)));
+        if (guard.isNull())
+            break;
+        syncStates();
+        //The player reconnected, so the caller asks the new agent
+        if (seated && findPlayer(agent) == nullptr)
+            break;
+    }
+    QObject::disconnect(connection);
+    return reply;
+}
+
+void GameLogic::openJournal()
+{
+    delete m_journal;
+    m_journal = nullptr;
+    if (m_journalDirectory.isEmpty())
+        return;
+
+    QString fileName = QString("room%1-%2.qsj").arg(room()->id()).arg(m_random.seed());
+    m_journal = new GameJournal(QDir(m_journalDirectory).filePath(fileName));
+}
+
+void GameLogic::closeJournal()
+{
+    //The writer flushes and closes the files after the records queued before
+    delete m_journal;
+    m_journal = nullptr;
+}
+
+static QVariant AreaSnapshot(const CardArea *area, bool visible)
+{
+    if (!visible)
+        return area->length();
+
+    QVariantList cardData;
+    foreach (const Card *card, area->cards())
+        cardData << card->id();
+    return cardData;
+}
 
-        if (damage.to)
-            trigger(PreDamageDone, damage.to, data);
+QVariant GameLogic::snapshot(const ServerPlayer *viewer) const
+{
+    QVariantMap state;
+    state["round"] = m_round;
+    state["currentPlayerId"] = m_currentPlayer ? m_currentPlayer->id() : 0;
+
+    QVariantList playerData;
+    QList<ServerPlayer *> players = this->players();
+    foreach (const ServerPlayer *player, players) {
+        QVariantMap data;
+        data["id"] = player->id();
+
+        QVariantList properties;
+        for (int i = 0; i < Player::PropertyCount; i++)
+            properties << player->property(Player::propertyName(static_cast<Player::Property>(i)));
+        data["properties"] = properties;
+
+        data["handcards"] = AreaSnapshot(player->handcards(), viewer == nullptr || viewer == player);
+        data["equips"] = AreaSnapshot(player->equips(), true);
+        data["delayedTricks"] = AreaSnapshot(player->delayedTricks(), true);
+        data["judgeCards"] = AreaSnapshot(player->judgeCards(), true);
+        playerData << QVariant(data);
+    }
+    state["players"] = playerData;
 
-        if (damage.to && !trigger(DamageDone, damage.to, data)) {
-            QVariantList arg;
-            arg << damage.to->id();
-            arg << damage.nature;
-            arg << -damage.damage;
-            room()->broadcastNotification(S_COMMAND_DAMAGE, arg);
+    state["drawPile"] = AreaSnapshot(m_drawPile, viewer == nullptr);
+    state["discardPile"] = AreaSnapshot(m_discardPile, true);
+    state["table"] = AreaSnapshot(m_table, true);
+    return state;
+}
 
-            int newHp = damage.to->hp() - damage.damage;
-            damage.to->setHp(newHp);
-            damage.to->broadcastProperty("hp");
+void GameLogic::onUserAdded(CServerUser *user)
+{
+    //The agents and tokens of the players are changed on the logic thread while m_syncMutex is held
+    QList<CServerAgent *> agents = room()->agents();
+    QList<ServerPlayer *> players = this->players();
+    QMutexLocker locker(&m_syncMutex);
+    foreach (ServerPlayer *player, players) {
+        CServerAgent *agent = player->agent();
+        if (!player->reconnectToken().isEmpty() && (agent == nullptr || !agents.contains(agent))) {
+            m_reconnectUsers << user;
+            m_syncPending.store(1);
+            locker.unlock();
+
+            //A coroutine waiting for a reply asks the user at once
+            QMutexLocker taskLocker(&m_delayMutex);
+            if (m_task)
+                m_task->wake();
+            return;
         }
+    }
+}
 
-        if (damage.from)
-            trigger(Damage, damage.from, data);
+QVariantList GameLogic::seatInfo()
+{
+    QVariantList playerList;
+    for (int seat = 1; seat <= m_ring.length(); seat++) {
+        ServerPlayer *player = qobject_cast<ServerPlayer *>(m_ring.at(seat));
+        CServerAgent *agent = player->agent();
+        QVariantMap info;
+        //A player whose client left is sent without a user
+        if (agent) {
+            if (agent->controlledByClient())
+                info["userId"] = agent->id();
+            else
+                info["robotId"] = agent->id();
+        }
+        info["playerId"] = player->id();
+        playerList << info;
+    }
+    return playerList;
+}
 
-        if (damage.to)
-            trigger(Damaged, damage.to, data);
+//Seats in order: byte kind (0 if the client left, 1 for a user, 2 for a robot), varint agent id unless the kind is 0, varint player id
+static QVariant EncodeSeats(const QVariantList &playerList)
+{
+    WireWriter writer;
+    writer.writeVarint(playerList.length());
+    foreach (const QVariant &rawInfo, playerList) {
+        const QVariantMap info = rawInfo.toMap();
+        if (info.contains("userId")) {
+            writer.writeByte(1);
+            writer.writeVarint(info["userId"].toUInt());
+        } else if (info.contains("robotId")) {
+            writer.writeByte(2);
+            writer.writeVarint(info["robotId"].toUInt());
+        } else {
+            writer.writeByte(0);
+        }
+        writer.writeVarint(info["playerId"].toUInt());
+    }
+    return writer.toVariant();
+}
+
+void GameLogic::syncStates()
+{
+    if (m_syncPending.load() == 0)
+        return;
 
-        if (damage.to)
-            trigger(DamageComplete, damage.to, data);
+    m_syncMutex.lock();
+    QList<QPointer<CServerUser>> users = m_reconnectUsers;
+    m_reconnectUsers.clear();
+    m_syncPending.store(0);
+    m_syncMutex.unlock();
 
-    } catch (EventType e) {
-        //@to-do: handle TurnBroken and StageChange
-        throw e;
+    //Screen names aren't verified, so a seat is only given back to the client holding the token it was sent at ARRANGE_SEAT
+    QList<ServerPlayer *> players;
+    foreach (const QPointer<CServerUser> &user, users) {
+        if (user.isNull())
+            continue;
+        user->request(S_COMMAND_RECONNECT, QVariant(), NegotiationTimeout);
+        QString token = waitForReply(user, NegotiationTimeout).toString();
+        if (token.isEmpty() || user.isNull())
+            continue;
+
+        QList<CServerAgent *> agents = room()->agents();
+        QList<ServerPlayer *> allPlayers = this->players();
+        foreach (ServerPlayer *player, allPlayers) {
+            CServerAgent *agent = player->agent();
+            if (player->reconnectToken() != token || (agent && agents.contains(agent)))
+                continue;
+            m_syncMutex.lock();
+            player->setAgent(user);
+            m_syncMutex.unlock();
+            players << player;
+            break;
+        }
+    }
+
+    QVariantList seats = seatInfo();
+    QVariantList cardData;
+    QList<const Card *> cards = m_cardTable.cards();
+    foreach (const Card *card, cards)
+        cardData << card->id();
+
+    foreach (ServerPlayer *player, players) {
+        CServerAgent *agent = player->agent();
+        if (agent == nullptr)
+            continue;
+
+        QVariantMap state = snapshot(player).toMap();
+        state["seats"] = seats;
+        state["cards"] = cardData;
+        state["protocolVersion"] = int(WireWriter::Version);
+
+        QVariantList history;
+        const QVector<int> &cardHistory = player->cardHistory();
+        foreach (int times, cardHistory)
+            history << times;
+        state["cardHistory"] = history;
+
+        //The new client replies with the version of the binary wire format it supports, like to S_COMMAND_NEGOTIATE_PROTOCOL.
+        //The request it was expected to reply to is sent again by ServerPlayer::waitForReply().
+        if (m_journal)
+            m_journal->recordSync(player->id(), state);
+        agent->request(S_COMMAND_SYNC_STATE, state, NegotiationTimeout);
+        QVariant reply = waitForReply(agent, NegotiationTimeout);
+        if (m_journal)
+            m_journal->recordReply(agent, S_COMMAND_SYNC_STATE, reply);
+        player->setProtocolVersion(reply.toInt());
     }
 }
 
-void GameLogic::delay(ulong msecs)
+void GameLogic::recordSnapshot()
+{
+    if (m_journal && m_journal->beginTurn()) {
+        flushPropertyChanges();
+        m_journal->recordSnapshot(snapshot());
+    }
+}
+
+void GameLogic::insertHandler(EventType event, const EventHandler *handler, int seat)
 {
-    QThread::currentThread()->msleep(msecs);
+    QList<HandlerBucket> &buckets = m_handlers[event];
+    int priority = handler->priority(event);
+    quint32 owner = 1u << seat;
+
+    int i = 0;
+    for (; i < buckets.length(); i++) {
+        HandlerBucket &bucket = buckets[i];
+        if (bucket.priority == priority) {
+            for (int j = 0; j < bucket.handlers.length(); j++) {
+                HandlerEntry &entry = bucket.handlers[j];
+                if (entry.handler == handler) {
+                    entry.owners |= owner;
+                    return;
+                }
+            }
+
+            HandlerEntry entry;
+            entry.handler = handler;
+            entry.owners = owner;
+            bucket.handlers << entry;
+            return;
+        } else if (bucket.priority < priority) {
+            break;
+        }
+    }
+
+    HandlerBucket bucket;
+    bucket.priority = priority;
+    HandlerEntry entry;
+    entry.handler = handler;
+    entry.owners = owner;
+    bucket.handlers << entry;
+    buckets.insert(i, bucket);
+}
+
+void GameLogic::removeHandler(EventType event, const EventHandler *handler, int seat)
+{
+    QList<HandlerBucket> &buckets = m_handlers[event];
+    int priority = handler->priority(event);
+    quint32 owner = 1u << seat;
+
+    for (int i = 0; i < buckets.length(); i++) {
+        HandlerBucket &bucket = buckets[i];
+        if (bucket.priority != priority)
+            continue;
+
+        for (int j = 0; j < bucket.handlers.length(); j++) {
+            HandlerEntry &entry = bucket.handlers[j];
+            if (entry.handler != handler)
+                continue;
+
+            entry.owners &= ~owner;
+            if (entry.owners == 0) {
+                bucket.handlers.removeAt(j);
+                if (bucket.handlers.isEmpty())
+                    buckets.removeAt(i);
+            }
+            return;
+        }
+        return;
+    }
+}
+
+void GameLogic::updateHandlerOwners()
+{
+    //Skills are registered by the seats of their owners, which have just changed
+    for (int event = 0; event < EventTypeCount; event++) {
+        QList<HandlerBucket> &buckets = m_handlers[event];
+        for (int i = 0; i < buckets.length(); i++) {
+            QList<HandlerEntry> &handlers = buckets[i].handlers;
+            for (int j = 0; j < handlers.length(); j++) {
+                HandlerEntry &entry = handlers[j];
+                entry.owners &= 1u;
+                for (int seat = 1; seat <= m_ring.length(); seat++) {
+                    const Player *player = m_ring.at(seat);
+                    if (player && player->hasSkill(entry.handler))
+                        entry.owners |= 1u << seat;
+                }
+            }
+        }
+    }
+
+    updateLiveEvents();
+}
+
+void GameLogic::updateLiveEvents()
+{
+    quint32 aliveSeats = m_ring.aliveSeats() | 1;
+    m_aliveSeats = aliveSeats;
+
+    quint64 liveEvents = 0;
+    for (int event = 0; event < EventTypeCount; event++) {
+        foreach (const HandlerBucket &bucket, m_handlers[event]) {
+            foreach (const HandlerEntry &entry, bucket.handlers) {
+                if (entry.owners & aliveSeats)
+                    liveEvents |= Q_UINT64_C(1) << event;
+            }
+        }
+    }
+    m_liveEvents = liveEvents;
 }
 
 CAbstractPlayer *GameLogic::createPlayer(CServerUser *user)
 {
-    C_UNUSED(user);
-    return new ServerPlayer(this, user);
+    ServerPlayer *player = new ServerPlayer(this, user);
+    player->setCardTable(&m_cardTable);
+    connect(player, &Player::aliveChanged, this, &GameLogic::updateLiveEvents, Qt::DirectConnection);
+    connect(player, &Player::seatChanged, this, &GameLogic::updateHandlerOwners, Qt::DirectConnection);
+    return player;
 }
 
 CAbstractPlayer *GameLogic::createPlayer(CServerRobot *robot)
 {
-    C_UNUSED(robot);
-    return new ServerPlayer(this, robot);
+    ServerPlayer *player = new ServerPlayer(this, robot);
+    player->setCardTable(&m_cardTable);
+    connect(player, &Player::aliveChanged, this, &GameLogic::updateLiveEvents, Qt::DirectConnection);
+    connect(player, &Player::seatChanged, this, &GameLogic::updateHandlerOwners, Qt::DirectConnection);
+    return player;
 }
 
 void GameLogic::prepareToStart()
@@ -485,52 +1271,59 @@ void GameLogic::prepareToStart()
 
     //Arrange seats for all the players
     QList<ServerPlayer *> players = this->players();
-    qShuffle(players);
-    for (int i = 1; i < players.length(); i++) {
-        players[i - 1]->setSeat(i);
-        players[i - 1]->setNext(players.at(i));
-    }
-    ServerPlayer *lastPlayer = players.last();
-    lastPlayer->setSeat(players.length());
-    lastPlayer->setNext(players.first());
+    qShuffle(players, m_random);
+    QList<Player *> seats;
+    foreach (ServerPlayer *player, players)
+        seats << player;
+    m_ring.arrange(seats);
     setCurrentPlayer(players.first());
+    updateLiveEvents();
 
-    QVariantList playerList;
+    negotiateProtocol(players);
+
+    QVariantList playerList = seatInfo();
+    broadcastNotification(S_COMMAND_ARRANGE_SEAT, playerList, EncodeSeats(playerList));
+
+    //Each client gets the token that takes its seat back if it reconnects. It is kept out of the journal.
     foreach (ServerPlayer *player, players) {
-        CServerAgent *agent = findAgent(player);
-        QVariantMap info;
-        if (agent->controlledByClient()) {
-            info["userId"] = agent->id();
-        } else {
-            info["robotId"] = agent->id();
-        }
-        info["playerId"] = player->id();
-        playerList << info;
+        CServerAgent *agent = player->agent();
+        if (agent == nullptr || !agent->controlledByClient())
+            continue;
+        QString token = QUuid::createUuid().toString();
+        m_syncMutex.lock();
+        player->setReconnectToken(token);
+        m_syncMutex.unlock();
+        agent->notify(S_COMMAND_RECONNECT_TOKEN, token);
     }
-    room->broadcastNotification(S_COMMAND_ARRANGE_SEAT, playerList);
 
-    //Import packages
+    //Import packages. The room shares the card definitions of the packages.
     QList<const General *> generals;
     foreach (const Package *package, m_packages) {
         generals << package->generals();
         QList<const Card *> cards = package->cards();
         foreach (const Card *card, cards)
-            m_cards.insert(card->id(), card->clone());
+            m_cardTable.add(card);
     }
 
     //Prepare cards
+    QList<const Card *> cards = m_cardTable.cards();
     QVariantList cardData;
-    foreach (const Card *card, m_cards)
+    foreach (const Card *card, cards)
         cardData << card->id();
     room->broadcastNotification(S_COMMAND_PREPARE_CARDS, cardData);
+    if (m_journal)
+        m_journal->recordNotification(S_COMMAND_PREPARE_CARDS, cardData);
 
     //Choose 7 random generals for each player
     //@to-do: config
     int candidateLimit = 7;
-    qShuffle(generals);
+    qShuffle(generals, m_random);
 
     QMap<ServerPlayer *, QList<const General *>> playerCandidates;
 
+    int timeout = m_requestTimeout;
+    flushPropertyChanges();
+
     foreach (ServerPlayer *player, players) {
         QList<const General *> candidates = generals.mid((player->seat() - 1) * candidateLimit, candidateLimit);
         playerCandidates[player] = candidates;
@@ -546,26 +1339,20 @@ void GameLogic::prepareToStart()
         data << QVariant(candidateData);
         data << QVariant(bannedPairData);
 
-        CServerAgent *agent = findAgent(player);
-        agent->prepareRequest(S_COMMAND_CHOOSE_GENERAL, data);
+        //All the requests are sent before the replies are waited for, so the players choose at the same time
+        player->request(S_COMMAND_CHOOSE_GENERAL, data, timeout);
     }
 
-    //@to-do: timeout should be loaded from config
-    room->broadcastRequest(room->agents(), 15000);
-
     foreach (ServerPlayer *player, players) {
         const QList<const General *> &candidates = playerCandidates[player];
         QList<const General *> generals;
 
-        CServerAgent *agent = findAgent(player);
-        if (agent) {
-            QVariantList reply = agent->waitForReply(0).toList();
-            foreach (const QVariant &choice, reply) {
-                QString name = choice.toString();
-                foreach (const General *general, candidates) {
-                    if (general->name() == name)
-                        generals << general;
-                }
+        QVariantList reply = player->waitForReply().toList();
+        foreach (const QVariant &choice, reply) {
+            QString name = choice.toString();
+            foreach (const General *general, candidates) {
+                if (general->name() == name)
+                    generals << general;
             }
         }
 
@@ -575,12 +1362,16 @@ void GameLogic::prepareToStart()
 
         player->setHeadGeneral(generals.at(0));
         player->setDeputyGeneral(generals.at(1));
-    }
 
-    foreach (Card *card, m_cards) {
-        m_drawPile->add(card);
-        m_cardPosition[card] = m_drawPile;
+        for (int i = 0; i < 2; i++) {
+            QList<const Skill *> skills = generals.at(i)->getSkillList();
+            foreach (const Skill *skill, skills)
+                acquireSkill(player, skill);
+        }
     }
+
+    qShuffle(cards, m_random);
+    m_drawPile->add(cards);
 }
 
 CardArea *GameLogic::findArea(const CardsMoveStruct::Area &area)
@@ -615,47 +1406,105 @@ CardArea *GameLogic::findArea(const CardsMoveStruct::Area &area)
 
 void GameLogic::run()
 {
-    qsrand((uint) QDateTime::currentMSecsSinceEpoch());
+    if (m_scheduler == nullptr) {
+        play();
+        closeJournal();
+        return;
+    }
+
+    //CRoom::startGame() starts the logic as a thread, which only hands the game over to the scheduler and ends.
+    //No thread is held by the room while the game runs. finished() is held back until the game ends.
+    if (!m_spawned.testAndSetOrdered(0, 1))
+        return;
+    blockSignals(true);
+    m_scheduler->spawn([this](LogicTask *task){
+        m_delayMutex.lock();
+        m_task = task;
+        m_delayMutex.unlock();
+
+        play();
+        closeJournal();
+
+        m_delayMutex.lock();
+        m_task = nullptr;
+        m_delayMutex.unlock();
+
+        //The thread may not have returned from run() yet
+        wait();
+        m_spawned.store(0);
+        blockSignals(false);
+        QMetaObject::invokeMethod(this, "finished", Qt::DirectConnection);
+    });
+}
+
+void GameLogic::play()
+{
+    //Pass the seed to setSeed() to replay the game
+    qDebug("Room %u starts a game with random seed %llu", room()->id(), m_random.seed());
+    openJournal();
 
     prepareToStart();
 
-    //@to-do: Turn broken event
-    QList<ServerPlayer *> allPlayers = this->allPlayers();
-    foreach (ServerPlayer *player, allPlayers)
-        trigger(GameStart, player);
+    foreach (ServerPlayer *player, actionOrder()) {
+        if (trigger(GameStart, player) && !handleInterruption())
+            return;
+    }
 
     forever {
-        try {
-            forever {
-                ServerPlayer *current = currentPlayer();
-                if (current->seat() == 1)
-                    m_round++;
-
-                trigger(TurnStart, current);
-                ServerPlayer *next = current->nextAlive(1, false);
-                while (!m_extraTurns.isEmpty()) {
-                    ServerPlayer *extra = m_extraTurns.takeFirst();
-                    setCurrentPlayer(extra);
-                    trigger(TurnStart, extra);
-                }
-                setCurrentPlayer(next);
-            }
-        } catch (EventType event) {
-            if (event == GameFinish) {
+        ServerPlayer *current = currentPlayer();
+        if (current->seat() == 1)
+            m_round++;
+
+        recordSnapshot();
+        trigger(TurnStart, current);
+        //A stage change restarts the turn loop from the current player
+        bool stageChanged = m_interruption == StageChange;
+        if (!handleInterruption())
+            return;
+        if (stageChanged)
+            continue;
+
+        ServerPlayer *next = current->nextAlive(1, false);
+        while (!m_extraTurns.isEmpty()) {
+            ServerPlayer *extra = m_extraTurns.takeFirst();
+            setCurrentPlayer(extra);
+            recordSnapshot();
+            trigger(TurnStart, extra);
+            stageChanged = m_interruption == StageChange;
+            if (!handleInterruption())
                 return;
-            } else if (event == TurnBroken) {
-                ServerPlayer *current = currentPlayer();
-                trigger(TurnBroken, current);
-                ServerPlayer *next = current->nextAlive(1, false);
-                if (current->phase() != Player::NotActive) {
-                    QVariant data;
-                    m_gameRule->effect(this, PhaseEnd, current, data, current);
-                    //@todo:
-                    current->setPhase(Player::NotActive);
-                    current->broadcastProperty("phase");
-                }
-                setCurrentPlayer(next);
-            }
+            if (stageChanged)
+                break;
         }
+        if (!stageChanged)
+            setCurrentPlayer(next);
+    }
+}
+
+bool GameLogic::handleInterruption()
+{
+    if (m_interruption == InvalidEvent)
+        return true;
+    if (m_interruption == GameFinish) {
+        //Nothing else is sent once the game finishes
+        flushPropertyChanges();
+        return false;
     }
+
+    //TurnBroken or StageChange. Clear it first so that the handlers can be triggered.
+    EventType reason = m_interruption;
+    m_interruption = InvalidEvent;
+
+    ServerPlayer *current = currentPlayer();
+    trigger(reason, current);
+    //The turn isn't closed on a stage change, as run() restarts the turn loop
+    if (reason == TurnBroken && current->phase() != Player::NotActive) {
+        EventData data;
+        m_gameRule->effect(this, PhaseEnd, current, data, current);
+        //@todo:
+        current->setPhase(Player::NotActive);
+        current->broadcastProperty(Player::PhaseProperty);
+    }
+
+    return m_interruption != GameFinish;
 }
@@ -20,17 +20,31 @@
 #ifndef CGAMELOGIC_H
 #define CGAMELOGIC_H
 
+#include "cardtable.h"
 #include "event.h"
+#include "eventdata.h"
 #include "eventtype.h"
+#include "playerring.h"
+#include "randomgenerator.h"
 #include "structs.h"
 
 #include <cabstractgamelogic.h>
 
+#include <QAtomicInt>
+#include <QMap>
+#include <QMutex>
+#include <QPointer>
+#include <QWaitCondition>
+
 class Card;
 class CardArea;
+class GameJournal;
 class GameRule;
+class LogicScheduler;
+class LogicTask;
 class ServerPlayer;
 class Package;
+class Skill;
 
 class GameLogic : public CAbstractGameLogic
 {
@@ -41,11 +55,43 @@ public:
     ~GameLogic();
 
     void setGameRule(const GameRule *rule);
+    const GameRule *gameRule() const { return m_gameRule; }
     void setPackages(const QList<const Package *> &packages) { m_packages = packages; }
 
+    //Milliseconds a player has to reply to a request
+    int requestTimeout() const { return m_requestTimeout; }
+    void setRequestTimeout(int timeout) { m_requestTimeout = timeout; }
+
+    //Global handlers are asked on every trigger like the game rule.
+    //Skills are only asked while their owners are alive, see acquireSkill().
     void addEventHandler(const EventHandler *handler);
     bool trigger(EventType event, ServerPlayer *target);
-    bool trigger(EventType event, ServerPlayer *target, QVariant &data);
+    //Payloads not matching EventData::typeOf(event) are rejected
+    bool trigger(EventType event, ServerPlayer *target, EventData &data);
+
+    //The payload type is bound to the event at compile time, see EventPayload
+    template<EventType event>
+    bool trigger(ServerPlayer *target, typename EventPayload<event>::Type &data)
+    {
+        EventData eventData(&data);
+        return trigger(event, target, eventData);
+    }
+
+    //Whether the event has a handler owned by an alive player or the game rule
+    bool hasLiveHandler(EventType event) const { return (m_liveEvents >> event) & 1; }
+    //Both count one trigger per target of an event
+    quint64 dispatchedTriggerNum() const { return m_dispatchedTriggerNum; }
+    quint64 skippedTriggerNum() const { return m_skippedTriggerNum; }
+    quint64 moveNum() const { return m_moveNum; }
+
+    //Breaks the current turn (TurnBroken), restarts the turn loop from the current player (StageChange) or ends the game (GameFinish).
+    //Every trigger returns true as broken until run() handles the interruption.
+    void interrupt(EventType reason);
+    EventType interruption() const { return m_interruption; }
+    bool isInterrupted() const { return m_interruption != InvalidEvent; }
+
+    void acquireSkill(ServerPlayer *player, const Skill *skill);
+    void detachSkill(ServerPlayer *player, const Skill *skill);
 
     void setCurrentPlayer(ServerPlayer *player) { m_currentPlayer = player; }
     ServerPlayer *currentPlayer() const { return m_currentPlayer; }
@@ -54,10 +100,20 @@ public:
     ServerPlayer *findPlayer(uint id) const;
     ServerPlayer *findPlayer(CServerAgent *agent) const;
 
+    //Iterates the players in action order from the current player without building a list
+    PlayerRing::Range<ServerPlayer> actionOrder(bool includeDead = false) const;
     QList<ServerPlayer *> allPlayers(bool includeDead = false) const;
     QList<ServerPlayer *> otherPlayers(ServerPlayer *except, bool includeDead = false) const;
+    //Sorts the players in place by action order
     void sortByActionOrder(QList<ServerPlayer *> &players) const;
 
+    int round() const { return m_round; }
+
+    //Every random choice of the game is drawn from this generator
+    RandomGenerator &random() { return m_random; }
+    quint64 seed() const { return m_random.seed(); }
+    void setSeed(quint64 seed) { m_random.setSeed(seed); }
+
     void addExtraTurn(ServerPlayer *player) { m_extraTurns << player; }
     QList<ServerPlayer *> extraTurns() const { return m_extraTurns; }
 
@@ -65,6 +121,9 @@ public:
     bool skipGameRule() const { return m_skipGameRule; }
 
     const CardArea *drawPile() const { return m_drawPile; }
+    //Top n cards of the draw pile. The discard pile is shuffled into it if it runs short.
+    QList<const Card *> getDrawPileCards(int n);
+    int reshuffleNum() const { return m_reshuffleNum; }
     const CardArea *discardPile() const { return m_discardPile; }
     const CardArea *table() const { return m_table; }
 
@@ -74,11 +133,48 @@ public:
     bool useCard(CardUseStruct &use);
     bool takeCardEffect(CardEffectStruct &effect);
 
-    Card *findCard(uint id) const { return m_cards.value(id); }
+    const Card *findCard(uint id) const { return m_cardTable.card(id); }
+    //Cards of the room with their flags and positions
+    CardTable &cardTable() { return m_cardTable; }
+    const CardTable &cardTable() const { return m_cardTable; }
 
     void damage(DamageStruct &damage);
 
+    //Suspension points of the logic. They block the room thread, or suspend the coroutine if the logic runs on a scheduler.
+    //Delays are cosmetic and skipped in fast-forward mode or if no human client is in the room.
     void delay(ulong msecs);
+    QVariant waitForReply(CServerAgent *agent, int timeout);
+
+    //Ends the current delay at once if enabled
+    void setFastForward(bool enabled);
+    bool isFastForward() const { return m_fastForward.load() != 0; }
+
+    //Each game records the messages of the room into a journal in the directory if it is set.
+    //The journal is opened when the game starts and closed when it ends.
+    void setJournalDirectory(const QString &path) { m_journalDirectory = path; }
+    QString journalDirectory() const { return m_journalDirectory; }
+    GameJournal *journal() const { return m_journal; }
+
+    //State of the room as seen by the viewer. Nothing is hidden if viewer is nullptr.
+    QVariant snapshot(const ServerPlayer *viewer = nullptr) const;
+
+    //Runs the game as a coroutine on the workers of the scheduler, which may be shared by many rooms.
+    //The thread started by CRoom::startGame() ends at once, and finished() is emitted when the game ends.
+    void setScheduler(LogicScheduler *scheduler) { m_scheduler = scheduler; }
+    LogicScheduler *scheduler() const { return m_scheduler; }
+
+    //Asks the clients of the players for the version of the binary wire format they support
+    void negotiateProtocol(const QList<ServerPlayer *> &players);
+
+    //Agents whose players negotiated the binary wire format get binaryData, the others get data
+    bool isBinaryProtocolEnabled(CServerAgent *agent) const;
+    void notify(CServerAgent *agent, int command, const QVariant &data, const QVariant &binaryData);
+    void broadcastNotification(int command, const QVariant &data, const QVariant &binaryData, CServerAgent *except = nullptr);
+
+    //Property changes are sent to everyone but except, or only to receiver if it is set.
+    //They are buffered and sent as one message per agent before the next notification or request.
+    void addPropertyChange(const ServerPlayer *player, Player::Property property, const QVariant &value, CServerAgent *receiver = nullptr, CServerAgent *except = nullptr);
+    void flushPropertyChanges();
 
 protected:
     CAbstractPlayer *createPlayer(CServerUser *user);
@@ -89,23 +185,101 @@ protected:
 
     void run();
 
+private slots:
+    //A user joining the room during the game takes back the seat of the player it left if it has the reconnect token of the seat.
+    //The seat is bound and the state of the room is sent in one message before the next message of the logic.
+    void onUserAdded(CServerUser *user);
+
 private:
-    QList<const EventHandler *> m_handlers[EventTypeCount];
+    //Returns true and counts targetNum skipped triggers if the event has no live handler
+    bool skipTrigger(EventType event, int targetNum = 1);
+    void play();
+    bool handleInterruption();
+    int actionStartSeat() const;
+    void reshuffleDrawPile();
+    void notifyMoves(const QList<CardsMoveStruct> &moves);
+    void recordSnapshot();
+    void openJournal();
+    void closeJournal();
+    QVariantList seatInfo();
+    void syncStates();
+
+    //Interval of polling an agent without a reply signal inside a coroutine
+    enum { ReplyPollInterval = 20 };
+    //Longest wait of a blocked thread before it looks for reconnected clients
+    enum { SyncCheckInterval = 500 };
+    //Longest wait for the protocol version of a client
+    enum { NegotiationTimeout = 3000 };
+
+    struct HandlerEntry
+    {
+        const EventHandler *handler;
+        //Bit n is set if the player on seat n owns the handler. Bit 0 stands for global handlers.
+        quint32 owners;
+    };
+
+    struct HandlerBucket
+    {
+        int priority;
+        QList<HandlerEntry> handlers;
+    };
+
+    void insertHandler(EventType event, const EventHandler *handler, int seat = 0);
+    void removeHandler(EventType event, const EventHandler *handler, int seat = 0);
+    //Moves the handlers of the skills to the seats their owners have now
+    void updateHandlerOwners();
+    void updateLiveEvents();
+
+    struct PropertyChange
+    {
+        uint playerId;
+        Player::Property property;
+        QVariant value;
+        CServerAgent *receiver;
+        CServerAgent *except;
+    };
+
+    //Handlers of each event, grouped by priority in descending order
+    QList<HandlerBucket> m_handlers[EventTypeCount];
+    quint32 m_aliveSeats;
+    quint64 m_liveEvents;
+    quint64 m_dispatchedTriggerNum;
+    quint64 m_skippedTriggerNum;
+    quint64 m_moveNum;
+    EventType m_interruption;
     QList<ServerPlayer *> m_players;
+    PlayerRing m_ring;
     ServerPlayer *m_currentPlayer;
     QList<ServerPlayer *> m_extraTurns;
     const GameRule *m_gameRule;
     QList<const Package *> m_packages;
-    QMap<uint, Card *> m_cards;
+    CardTable m_cardTable;
     bool m_globalRequestEnabled;
     bool m_skipGameRule;
+    int m_requestTimeout;
     int m_round;
+    int m_reshuffleNum;
+    QAtomicInt m_fastForward;
+    QMutex m_delayMutex;
+    QWaitCondition m_delayCondition;
+    RandomGenerator m_random;
+    QString m_journalDirectory;
+    GameJournal *m_journal;
+    LogicScheduler *m_scheduler;
+    //The coroutine the game runs in, guarded by m_delayMutex
+    LogicTask *m_task;
+    //Set while a game of the logic is on the scheduler
+    QAtomicInt m_spawned;
+    QList<PropertyChange> m_propertyChanges;
+    QMutex m_syncMutex;
+    QAtomicInt m_syncPending;
+    //Users to be asked for a reconnect token
+    QList<QPointer<CServerUser>> m_reconnectUsers;
 
     CardArea *m_drawPile;
     CardArea *m_discardPile;
     CardArea *m_table;
 
-    QMap<Card *, CardArea *> m_cardPosition;
 };
 
 #endif // CGAMELOGIC_H
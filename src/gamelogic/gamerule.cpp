@@ -38,27 +38,30 @@ bool GameRule::triggerable(ServerPlayer *) const
     return true;
 }
 
-bool GameRule::effect(GameLogic *logic, EventType event, ServerPlayer *current, QVariant &data, Player *) const
+void GameRule::triggerable(GameLogic *, EventType, ServerPlayer *current, EventData &, EventList &events) const
+{
+    events << Event(this, current);
+}
+
+bool GameRule::effect(GameLogic *logic, EventType event, ServerPlayer *current, EventData &data, Player *) const
 {
     if (logic->skipGameRule())
         return false;
 
-    Callback func = m_callbacks[event];
+    Callback func = m_callbacks.value(event);
     if (func)
         (this->*func)(current, data);
-    else
-        throw GameFinish;
 
     return false;
 }
 
-void GameRule::onGameStart(ServerPlayer *current, QVariant &) const
+void GameRule::onGameStart(ServerPlayer *current, EventData &) const
 {
-    current->broadcastProperty("headGeneralName", "anjiang", current);
-    current->broadcastProperty("deputyGeneralName", "anjiang", current);
+    current->broadcastProperty(Player::HeadGeneralNameProperty, "anjiang", current);
+    current->broadcastProperty(Player::DeputyGeneralNameProperty, "anjiang", current);
 
-    current->notifyPropertyTo("headGeneralName", current);
-    current->notifyPropertyTo("deputyGeneralName", current);
+    current->notifyPropertyTo(Player::HeadGeneralNameProperty, current);
+    current->notifyPropertyTo(Player::DeputyGeneralNameProperty, current);
 
     const General *headGeneral = current->headGeneral();
     const General *deputyGeneral = current->deputyGeneral();
@@ -68,18 +71,18 @@ void GameRule::onGameStart(ServerPlayer *current, QVariant &) const
     int hp = (headHp + deputyHp) / 2;
     current->setMaxHp(hp);
     current->setHp(hp);
-    current->broadcastProperty("maxHp");
-    current->broadcastProperty("hp");
+    current->broadcastProperty(Player::MaxHpProperty);
+    current->broadcastProperty(Player::HpProperty);
 
     current->setRole(headGeneral->kingdom());
-    current->notifyPropertyTo("role", current);
+    current->notifyPropertyTo(Player::RoleProperty, current);
     current->setKingdom(headGeneral->kingdom());
-    current->notifyPropertyTo("kingdom", current);
+    current->notifyPropertyTo(Player::KingdomProperty, current);
 
     current->drawCards(4);
 }
 
-void GameRule::onTurnStart(ServerPlayer *current, QVariant &) const
+void GameRule::onTurnStart(ServerPlayer *current, EventData &) const
 {
     current->setTurnCount(current->turnCount() + 1);
     if (!current->faceUp())
@@ -88,23 +91,20 @@ void GameRule::onTurnStart(ServerPlayer *current, QVariant &) const
         current->play();
 }
 
-void GameRule::onPhaseProceeding(ServerPlayer *current, QVariant &) const
+void GameRule::onPhaseProceeding(ServerPlayer *current, EventData &) const
 {
     m_logic->delay(500);
     switch (current->phase()) {
     case Player::Draw: {
         int num = 2;
-        QVariant data(num);
-        m_logic->trigger(DrawNCards, current, data);
-        num = data.toInt();
-        if (num > 0)
+        m_logic->trigger<DrawNCards>(current, num);
+        if (num > 0 && !m_logic->isInterrupted())
             current->drawCards(num);
-        data = num;
-        m_logic->trigger(AfterDrawNCards, current, data);
+        m_logic->trigger<AfterDrawNCards>(current, num);
         break;
     }
     case Player::Play: {
-        while (current->isAlive()) {
+        while (current->isAlive() && !m_logic->isInterrupted()) {
             CardUseStruct use;
             current->activate(use);
             if (use.card != nullptr)
@@ -116,9 +116,7 @@ void GameRule::onPhaseProceeding(ServerPlayer *current, QVariant &) const
     }
     case Player::Discard: {
         int maxCardNum = current->hp();
-        QVariant data(maxCardNum);
-        m_logic->trigger(CountMaxCardNum, current, data);
-        maxCardNum = data.toInt();
+        m_logic->trigger<CountMaxCardNum>(current, maxCardNum);
         int discardNum = current->handcardNum() - maxCardNum;
         //@to-do: discarding cards if (discardNum > 0)
         break;
@@ -33,13 +33,14 @@ public:
     GameRule(GameLogic *logic);
 
     bool triggerable(ServerPlayer *) const override;
-    bool effect(GameLogic *logic, EventType event, ServerPlayer *current, QVariant &data, Player *) const override;
+    void triggerable(GameLogic *, EventType, ServerPlayer *current, EventData &, EventList &events) const override;
+    bool effect(GameLogic *logic, EventType event, ServerPlayer *current, EventData &data, Player *) const override;
 
 protected:
-    typedef void (GameRule::*Callback)(ServerPlayer *, QVariant &) const;
-    void onGameStart(ServerPlayer *current, QVariant &) const;
-    void onTurnStart(ServerPlayer *current, QVariant &) const;
-    void onPhaseProceeding(ServerPlayer *current, QVariant &) const;
+    typedef void (GameRule::*Callback)(ServerPlayer *, EventData &) const;
+    void onGameStart(ServerPlayer *current, EventData &) const;
+    void onTurnStart(ServerPlayer *current, EventData &) const;
+    void onPhaseProceeding(ServerPlayer *current, EventData &) const;
 
     GameLogic *m_logic;
     static QMap<EventType, Callback> m_callbacks;
@@ -0,0 +1,210 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+
+#include "logicscheduler.h"
+
+#include <QMetaMethod>
+#include <QThread>
+
+LogicTask::LogicTask(LogicScheduler *scheduler, const Function &func)
+    : m_scheduler(scheduler)
+    , m_coroutine([this, func](){
+        func(this);
+    })
+    , m_wakeDelay(-1)
+    , m_woken(false)
+    , m_cancelled(false)
+{
+}
+
+void LogicTask::sleep(ulong msecs)
+{
+    if (!Coroutine::isSupported()) {
+        QThread::msleep(msecs);
+        return;
+    }
+
+    m_scheduler->m_mutex.lock();
+    if (m_woken || m_cancelled) {
+        m_woken = false;
+        m_scheduler->m_mutex.unlock();
+        return;
+    }
+    m_wakeDelay = msecs;
+    m_scheduler->m_mutex.unlock();
+
+    m_coroutine.yield();
+}
+
+QMetaObject::Connection LogicTask::wakeOn(QObject *sender, const char *signal)
+{
+    const QMetaObject *metaObject = sender->metaObject();
+    int index = metaObject->indexOfSignal(QMetaObject::normalizedSignature(signal));
+    if (index < 0)
+        return QMetaObject::Connection();
+
+    QMetaMethod slot = staticMetaObject.method(staticMetaObject.indexOfSlot("wake()"));
+    //The slot runs on the thread emitting the signal
+    return connect(sender, metaObject->method(index), this, slot, Qt::DirectConnection);
+}
+
+bool LogicTask::isCancelled() const
+{
+    QMutexLocker locker(&m_scheduler->m_mutex);
+    return m_cancelled;
+}
+
+void LogicTask::wake()
+{
+    LogicScheduler *scheduler = m_scheduler;
+    QMutexLocker locker(&scheduler->m_mutex);
+    for (QMultiMap<qint64, LogicTask *>::iterator i = scheduler->m_sleeping.begin(); i != scheduler->m_sleeping.end(); ++i) {
+        if (i.value() == this) {
+            scheduler->m_sleeping.erase(i);
+            scheduler->m_ready.enqueue(this);
+            scheduler->m_condition.wakeOne();
+            return;
+        }
+    }
+    //Running, or about to be put to sleep by its worker
+    if (!scheduler->m_ready.contains(this))
+        m_woken = true;
+}
+
+class LogicWorker : public QThread
+{
+public:
+    LogicWorker(const std::function<void()> &func)
+        : m_func(func)
+    {
+    }
+
+protected:
+    void run() override
+    {
+        m_func();
+    }
+
+private:
+    std::function<void()> m_func;
+};
+
+LogicScheduler::LogicScheduler(int workerNum)
+    : m_runningNum(0)
+    , m_stopping(false)
+{
+    m_clock.start();
+
+    if (workerNum <= 0)
+        workerNum = qMax(QThread::idealThreadCount(), 1);
+    for (int i = 0; i < workerNum; i++) {
+        QThread *worker = new LogicWorker([this](){
+            work();
+        });
+        worker->start();
+        m_workers << worker;
+    }
+}
+
+LogicScheduler::~LogicScheduler()
+{
+    m_mutex.lock();
+    m_stopping = true;
+    foreach (LogicTask *task, m_tasks)
+        task->m_cancelled = true;
+    foreach (LogicTask *task, m_sleeping)
+        m_ready.enqueue(task);
+    m_sleeping.clear();
+    m_condition.wakeAll();
+    m_mutex.unlock();
+
+    //The workers return once every task has
+    foreach (QThread *worker, m_workers) {
+        worker->wait();
+        delete worker;
+    }
+    Q_ASSERT(m_tasks.isEmpty());
+}
+
+void LogicScheduler::spawn(const LogicTask::Function &func)
+{
+    LogicTask *task = new LogicTask(this, func);
+    QMutexLocker locker(&m_mutex);
+    if (m_stopping)
+        task->m_cancelled = true;
+    m_tasks.insert(task);
+    m_ready.enqueue(task);
+    m_condition.wakeOne();
+}
+
+int LogicScheduler::coroutineNum() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_ready.length() + m_sleeping.size() + m_runningNum;
+}
+
+void LogicScheduler::work()
+{
+    QMutexLocker locker(&m_mutex);
+    forever {
+        //Wake up the tasks whose deadline passed
+        qint64 now = m_clock.elapsed();
+        while (!m_sleeping.isEmpty() && m_sleeping.firstKey() <= now) {
+            m_ready.enqueue(m_sleeping.first());
+            m_sleeping.erase(m_sleeping.begin());
+        }
+
+        if (m_ready.isEmpty()) {
+            if (m_stopping && m_runningNum == 0)
+                return;
+            if (m_sleeping.isEmpty())
+                m_condition.wait(&m_mutex);
+            else
+                m_condition.wait(&m_mutex, m_sleeping.firstKey() - now);
+            continue;
+        }
+
+        LogicTask *task = m_ready.dequeue();
+        task->m_wakeDelay = -1;
+        m_runningNum++;
+        locker.unlock();
+
+        task->m_coroutine.resume();
+
+        locker.relock();
+        m_runningNum--;
+        if (task->m_coroutine.isFinished()) {
+            m_tasks.remove(task);
+            delete task;
+            //Workers of a stopping scheduler may be waiting for the last task
+            if (m_stopping)
+                m_condition.wakeAll();
+        } else if (task->m_woken || task->m_wakeDelay <= 0 || m_stopping) {
+            task->m_woken = false;
+            m_ready.enqueue(task);
+        } else {
+            qint64 deadline = m_clock.elapsed() + task->m_wakeDelay;
+            //Another worker may be waiting for a later deadline
+            if (m_sleeping.isEmpty() || deadline < m_sleeping.firstKey())
+                m_condition.wakeOne();
+            m_sleeping.insert(deadline, task);
+        }
+    }
+}
@@ -0,0 +1,108 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+
+#ifndef LOGICSCHEDULER_H
+#define LOGICSCHEDULER_H
+
+#include "coroutine.h"
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QMultiMap>
+#include <QMutex>
+#include <QObject>
+#include <QQueue>
+#include <QSet>
+#include <QWaitCondition>
+
+class LogicScheduler;
+class QThread;
+
+//A coroutine of LogicScheduler. Its suspending functions must be called from inside the coroutine.
+class LogicTask : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef std::function<void(LogicTask *)> Function;
+
+    //Suspends the coroutine until msecs pass or wake() is called.
+    //Without coroutine support the thread sleeps instead.
+    void sleep(ulong msecs);
+
+    //Connects the signal to wake(). The connection is invalid if the sender has no such signal.
+    QMetaObject::Connection wakeOn(QObject *sender, const char *signal);
+
+    //Set when the scheduler is destroyed. sleep() returns at once, and the function must return as soon as it can.
+    bool isCancelled() const;
+
+public slots:
+    //Resumes the coroutine as soon as a worker is free. It may be called from any thread.
+    void wake();
+
+private:
+    friend class LogicScheduler;
+
+    LogicTask(LogicScheduler *scheduler, const Function &func);
+
+    LogicScheduler *m_scheduler;
+    Coroutine m_coroutine;
+    //Milliseconds to sleep after the last yield, or -1 to be resumed at once
+    qint64 m_wakeDelay;
+    //Set by wake() if the task wasn't sleeping yet
+    bool m_woken;
+    bool m_cancelled;
+};
+
+//Runs game logics as coroutines on a fixed number of worker threads.
+//A coroutine suspends itself with LogicTask::sleep() and is resumed by whichever worker is free once it is woken or its deadline passes.
+class LogicScheduler
+{
+public:
+    LogicScheduler(int workerNum = 0);
+    //Cancels every task and resumes it until it returns, so that nothing is left on the freed stacks
+    ~LogicScheduler();
+
+    //The task is deleted when the function returns
+    void spawn(const LogicTask::Function &func);
+
+    int workerNum() const { return m_workers.length(); }
+    int coroutineNum() const;
+
+private:
+    Q_DISABLE_COPY(LogicScheduler)
+
+    friend class LogicTask;
+
+    void work();
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_condition;
+    QQueue<LogicTask *> m_ready;
+    //Suspended tasks ordered by the time they wake up
+    QMultiMap<qint64, LogicTask *> m_sleeping;
+    QSet<LogicTask *> m_tasks;
+    int m_runningNum;
+    bool m_stopping;
+    QElapsedTimer m_clock;
+    QList<QThread *> m_workers;
+};
+
+#endif // LOGICSCHEDULER_H
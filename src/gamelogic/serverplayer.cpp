@@ -17,9 +17,12 @@
     Mogara
 *********************************************************************/
 
+#include "gamejournal.h"
 #include "gamelogic.h"
 #include "protocol.h"
 #include "serverplayer.h"
+#include "stringpool.h"
+#include "wireformat.h"
 
 #include <croom.h>
 #include <cserveragent.h>
@@ -29,6 +32,9 @@ ServerPlayer::ServerPlayer(GameLogic *logic, CServerAgent *agent)
     , m_logic(logic)
     , m_room(logic->room())
     , m_agent(agent)
+    , m_protocolVersion(0)
+    , m_requestCommand(S_COMMAND_INVALID_SANGUOSHA_COMMAND)
+    , m_requestTimeout(0)
 {
 }
 
@@ -44,12 +50,14 @@ CServerAgent *ServerPlayer::agent() const
 void ServerPlayer::setAgent(CServerAgent *agent)
 {
     m_agent = agent;
+    //The new client has not negotiated the binary wire format yet
+    m_protocolVersion = 0;
 }
 
 CRoom *ServerPlayer::room() const
 {
     if (m_room->isAbandoned())
-        throw GameFinish;
+        m_logic->interrupt(GameFinish);
     return m_room;
 }
 
@@ -60,7 +68,7 @@ void ServerPlayer::drawCards(int n)
     move.from.direction = CardArea::Top;
     move.to.type = CardArea::Hand;
     move.to.owner = this;
-    move.cards = m_logic->drawPile()->first(n);
+    move.cards = m_logic->getDrawPileCards(n);
     m_logic->moveCards(move);
 }
 
@@ -86,39 +94,37 @@ void ServerPlayer::play(const QList<Player::Phase> &phases)
         change.from = phase();
         change.to = to;
 
-        QVariant data = QVariant::fromValue(&change);
-        bool skip = m_logic->trigger(PhaseChanging, this, data);
+        bool skip = m_logic->trigger<PhaseChanging>(this, change);
 
         setPhase(change.to);
-        broadcastProperty("phase");
+        broadcastProperty(PhaseProperty);
 
-        if (skip && !m_logic->trigger(PhaseSkipping, this, data))
+        if (skip && !m_logic->trigger<PhaseSkipping>(this, change))
             continue;
 
         if (!m_logic->trigger(PhaseStart, this))
             m_logic->trigger(PhaseProceeding, this);
         m_logic->trigger(PhaseEnd, this);
+
+        //GameLogic::run() ends the broken turn
+        if (m_logic->isInterrupted())
+            return;
     }
 
     change.from = phase();
     change.to = NotActive;
-
-    QVariant data = QVariant::fromValue(&change);
-    m_logic->trigger(PhaseChanging, this, data);
+    m_logic->trigger<PhaseChanging>(this, change);
 
     setPhase(change.to);
-    broadcastProperty("phase");
+    broadcastProperty(PhaseProperty);
 }
 
 void ServerPlayer::activate(CardUseStruct &use)
 {
-    int timeout = 15 * 1000;
-    if (m_agent.isNull())
-        return;
-    m_agent->request(S_COMMAND_USE_CARD, QVariant(), timeout);
     if (m_agent.isNull())
         return;
-    QVariant replyData = m_agent->waitForReply(timeout);
+    request(S_COMMAND_USE_CARD, QVariant(), m_logic->requestTimeout());
+    QVariant replyData = waitForReply();
     if (replyData.isNull())
         return;
     QVariantMap reply = replyData.toMap();
@@ -141,7 +147,53 @@ void ServerPlayer::activate(CardUseStruct &use)
     }
 }
 
-Event ServerPlayer::askForTriggerOrder(const QString &reason, QList<Event> &options, bool cancelable)
+void ServerPlayer::request(int command, const QVariant &data, int timeout)
+{
+    m_requestCommand = command;
+    m_requestData = data;
+    m_requestTimeout = timeout;
+    m_requestTimer.start();
+
+    m_logic->flushPropertyChanges();
+    if (m_agent.isNull())
+        return;
+    GameJournal *journal = m_logic->journal();
+    if (journal)
+        journal->recordRequest(m_agent, command, data);
+    m_agent->request(command, data, timeout);
+}
+
+QVariant ServerPlayer::waitForReply()
+{
+    QVariant reply;
+    GameJournal *journal = m_logic->journal();
+    forever {
+        CServerAgent *agent = m_agent.data();
+        int remaining = m_requestTimeout - int(m_requestTimer.elapsed());
+        if (agent == nullptr)
+            break;
+
+        reply = m_logic->waitForReply(agent, qMax(remaining, 0));
+        if (journal)
+            journal->recordReply(agent, m_requestCommand, reply);
+        if (!reply.isNull() || m_agent.isNull() || m_agent.data() == agent)
+            break;
+
+        //The client reconnected while the player was expected to reply
+        remaining = m_requestTimeout - int(m_requestTimer.elapsed());
+        if (remaining <= 0)
+            break;
+        if (journal)
+            journal->recordRequest(m_agent, m_requestCommand, m_requestData);
+        m_agent->request(m_requestCommand, m_requestData, remaining);
+    }
+
+    m_requestCommand = S_COMMAND_INVALID_SANGUOSHA_COMMAND;
+    m_requestData = QVariant();
+    return reply;
+}
+
+Event ServerPlayer::askForTriggerOrder(const QString &reason, EventList &options, bool cancelable)
 {
     //@todo:
     C_UNUSED(reason);
@@ -150,49 +202,43 @@ Event ServerPlayer::askForTriggerOrder(const QString &reason, QList<Event> &opti
     return Event();
 }
 
-void ServerPlayer::broadcastProperty(const char *name) const
+void ServerPlayer::broadcastProperty(Property property) const
 {
-    QVariantList data;
-    data << id();
-    data << name;
-    data << property(name);
-    m_room->broadcastNotification(S_COMMAND_UPDATE_PLAYER_PROPERTY, data);
+    m_logic->addPropertyChange(this, property, this->property(propertyName(property)));
 }
 
-void ServerPlayer::broadcastProperty(const char *name, const QVariant &value, ServerPlayer *except) const
+void ServerPlayer::broadcastProperty(Property property, const QVariant &value, ServerPlayer *except) const
 {
-    QVariantList data;
-    data << id();
-    data << name;
-    data << value;
-    m_room->broadcastNotification(S_COMMAND_UPDATE_PLAYER_PROPERTY, data, except->agent());
+    CServerAgent *exceptAgent = except ? except->agent() : nullptr;
+    m_logic->addPropertyChange(this, property, value, nullptr, exceptAgent);
 }
 
-void ServerPlayer::notifyPropertyTo(const char *name, ServerPlayer *player)
+void ServerPlayer::notifyPropertyTo(Property property, ServerPlayer *player)
 {
-    QVariantList data;
-    data << id();
-    data << name;
-    data << property(name);
     CServerAgent *agent = player->agent();
     if (agent)
-        agent->notify(S_COMMAND_UPDATE_PLAYER_PROPERTY, data);
+        m_logic->addPropertyChange(this, property, this->property(propertyName(property)), agent);
 }
 
-void ServerPlayer::addCardHistory(const QString &name, int times)
+void ServerPlayer::addCardHistory(uint nameId, int times)
 {
-    Player::addCardHistory(name, times);
+    Player::addCardHistory(nameId, times);
+    if (m_agent.isNull())
+        return;
+
+    //Clients of another version may number the names differently, so only the binary payload carries the id
     QVariantList data;
-    data << name;
+    data << StringPool::cardNames()->string(nameId);
     data << times;
-
-    if (!m_agent.isNull())
-        m_agent->notify(S_COMMAND_ADD_CARD_HISTORY, data);
+    WireWriter writer;
+    writer.writeVarint(nameId);
+    writer.writeSignedVarint(times);
+    m_logic->notify(m_agent, S_COMMAND_ADD_CARD_HISTORY, data, writer.toVariant());
 }
 
 void ServerPlayer::clearCardHistory()
 {
     Player::clearCardHistory();
     if (!m_agent.isNull())
-        m_agent->notify(S_COMMAND_ADD_CARD_HISTORY);
+        m_logic->notify(m_agent, S_COMMAND_ADD_CARD_HISTORY, QVariant(), QVariant());
 }
@@ -20,6 +20,7 @@
 #ifndef SERVERPLAYER_H
 #define SERVERPLAYER_H
 
+#include <QElapsedTimer>
 #include <QPointer>
 
 #include "event.h"
@@ -39,10 +40,19 @@ public:
     ~ServerPlayer();
 
     CServerAgent *agent() const;
+    //Binds the player to the agent of a reconnected client. See GameLogic::onUserAdded().
     void setAgent(CServerAgent *agent);
 
+    //Secret sent to the client at ARRANGE_SEAT. A reconnecting client must present it to take the seat back. It is empty for robots.
+    QString reconnectToken() const { return m_reconnectToken; }
+    void setReconnectToken(const QString &token) { m_reconnectToken = token; }
+
     CRoom *room() const;
 
+    //Version of the binary wire format the client supports, 0 if it only knows the map-based one
+    int protocolVersion() const { return m_protocolVersion; }
+    void setProtocolVersion(int version) { m_protocolVersion = version; }
+
     ServerPlayer *next() const { return qobject_cast<ServerPlayer *>(Player::next()); }
     ServerPlayer *next(bool ignoreRemoved) const{ return qobject_cast<ServerPlayer *>(Player::next(ignoreRemoved)); }
     ServerPlayer *nextAlive(int step = 1, bool ignoreRemoved = true) const{ return qobject_cast<ServerPlayer *>(Player::nextAlive(step, ignoreRemoved)); }
@@ -52,19 +62,32 @@ public:
     void play(const QList<Phase> &phases);
     void activate(CardUseStruct &use);
 
-    Event askForTriggerOrder(const QString &reason, QList<Event> &options, bool cancelable);
-    void broadcastProperty(const char *name) const;
-    void broadcastProperty(const char *name, const QVariant &value, ServerPlayer *except = nullptr) const;
-    void notifyPropertyTo(const char *name, ServerPlayer *player);
+    //The player is expected to reply to the request until waitForReply() returns.
+    //If the client reconnects meanwhile, the new one is asked again for the rest of the time.
+    void request(int command, const QVariant &data, int timeout);
+    QVariant waitForReply();
+
+    Event askForTriggerOrder(const QString &reason, EventList &options, bool cancelable);
+
+    //Property updates are buffered by GameLogic and sent before the next notification or request
+    void broadcastProperty(Property property) const;
+    void broadcastProperty(Property property, const QVariant &value, ServerPlayer *except = nullptr) const;
+    void notifyPropertyTo(Property property, ServerPlayer *player);
 
-    void addCardHistory(const QString &name, int times = 1);
+    void addCardHistory(uint nameId, int times = 1);
     void clearCardHistory();
 
 private:
     GameLogic *m_logic;
     CRoom *m_room;
     QPointer<CServerAgent> m_agent;
+    QString m_reconnectToken;
     CardArea *m_handcards;
+    int m_protocolVersion;
+    int m_requestCommand;
+    QVariant m_requestData;
+    int m_requestTimeout;
+    QElapsedTimer m_requestTimer;
 };
 
 #endif // SERVERPLAYER_H
@@ -138,9 +138,9 @@ void RoomScene::onUsingCard(const QString &pattern)
     } else {
         //@todo: filter usable cards
         const ClientPlayer *self = m_client->findPlayer(m_client->self());
-        QList<Card *> cards = self->handcards()->cards();
+        QList<const Card *> cards = self->handcards()->cards();
         QVariantList cardIds;
-        foreach (Card *card, cards)
+        foreach (const Card *card, cards)
             cardIds << card->id();
         emit cardEnabled(cardIds);
     }
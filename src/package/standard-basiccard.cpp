@@ -23,34 +23,19 @@
 #include "standardpackage.h"
 #include "standard-basiccard.h"
 
-
-SlashEffectStruct::SlashEffectStruct()
-    : from(nullptr)
-    , to(nullptr)
-    , slash(nullptr)
-    , jink(nullptr)
-    , nature(DamageStruct::Normal)
-    , drank(0)
-    , jinkNum(1)
-    , nullified(false)
-{
-}
-
-
 Slash::Slash(Card::Suit suit, int number)
     : BasicCard(suit, number)
     , m_nature(DamageStruct::Normal)
-    , m_drank(0)
 {
     setObjectName("slash");
 }
 
-void Slash::onEffect(GameLogic *logic, CardEffectStruct &cardEffect)
+void Slash::onEffect(GameLogic *logic, CardEffectStruct &cardEffect) const
 {
     if (cardEffect.from->drank() > 0) {
-        m_drank = cardEffect.from->drank();
+        cardEffect.drank = cardEffect.from->drank();
         cardEffect.from->setDrank(0);
-        cardEffect.from->broadcastProperty("drank");
+        cardEffect.from->broadcastProperty(Player::DrankProperty);
     }
 
     SlashEffectStruct effect;
@@ -59,15 +44,13 @@ void Slash::onEffect(GameLogic *logic, CardEffectStruct &cardEffect)
     effect.slash = this;
 
     effect.to = cardEffect.to;
-    effect.drank = m_drank;
+    effect.drank = cardEffect.drank;
     effect.nullified = cardEffect.nullified;
 
-    QVariant data = QVariant::fromValue(&effect);
-
-    if (!logic->trigger(SlashEffect, effect.from, data)) {
-        if (!logic->trigger(SlashEffected, effect.to, data)) {
+    if (!logic->trigger<SlashEffect>(effect.from, effect)) {
+        if (!logic->trigger<SlashEffected>(effect.to, effect)) {
             if (effect.jinkNum > 0) {
-                if (!logic->trigger(SlashProceed, effect.from, data)) {
+                if (!logic->trigger<SlashProceed>(effect.from, effect)) {
                     //@to-do: ask for jink here
                 }
             }
@@ -76,7 +59,7 @@ void Slash::onEffect(GameLogic *logic, CardEffectStruct &cardEffect)
 
     if (effect.jink == nullptr) {
         if (effect.to->isAlive()) {
-            logic->trigger(SlashHit, effect.from, data);
+            logic->trigger<SlashHit>(effect.from, effect);
 
             DamageStruct damage;
             damage.from = effect.from;
@@ -85,7 +68,7 @@ void Slash::onEffect(GameLogic *logic, CardEffectStruct &cardEffect)
             logic->damage(damage);
         }
     } else {
-        logic->trigger(SlashMissed, effect.from, data);
+        logic->trigger<SlashMissed>(effect.from, effect);
     }
 }
 
@@ -22,24 +22,6 @@
 
 #include "card.h"
 
-struct SlashEffectStruct
-{
-    ServerPlayer *from;
-    ServerPlayer *to;
-
-    const Card *slash;
-    const Card *jink;
-
-    DamageStruct::Nature nature;
-    int drank;
-    int jinkNum;
-    bool nullified;
-
-    SlashEffectStruct();
-};
-
-Q_DECLARE_METATYPE(SlashEffectStruct *)
-
 class Slash : public BasicCard
 {
     Q_OBJECT
@@ -47,11 +29,10 @@ class Slash : public BasicCard
 public:
     Q_INVOKABLE Slash(Suit suit, int number);
 
-    void onEffect(GameLogic *logic, CardEffectStruct &cardEffect) override;
+    void onEffect(GameLogic *logic, CardEffectStruct &cardEffect) const override;
 
 protected:
     DamageStruct::Nature m_nature;
-    int m_drank;
 };
 
 #endif // STANDARDBASICCARD_H
@@ -0,0 +1,74 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+#include "cardarea.h"
+#include "cardareabenchmark.h"
+#include "cardtable.h"
+#include "engine.h"
+#include "randomgenerator.h"
+#include "util.h"
+
+#include <QElapsedTimer>
+#include <QTextStream>
+
+void RunCardAreaBenchmark(int roundNum)
+{
+    CardTable table;
+    QList<const Card *> deck = Engine::instance()->getCards();
+    foreach (const Card *card, deck)
+        table.add(card);
+
+    CardArea drawPile(CardArea::DrawPile);
+    drawPile.setCardTable(&table);
+    CardArea hand(CardArea::Hand);
+    hand.setCardTable(&table);
+    CardArea discardPile(CardArea::DiscardPile);
+    discardPile.setCardTable(&table);
+
+    drawPile.add(table.cards());
+    int cardNum = drawPile.length();
+    RandomGenerator random(1);
+
+    quint64 moveNum = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int round = 0; round < roundNum; round++) {
+        //Draw the whole pile card by card
+        while (drawPile.length() > 0) {
+            const Card *card = drawPile.takeFirst();
+            hand.add(card);
+        }
+
+        //Discard the hand in a random order, which removes cards from the middle of the hand
+        QList<const Card *> cards = hand.cards();
+        qShuffle(cards, random);
+        hand.remove(cards);
+        discardPile.add(cards);
+
+        //Shuffle the discard pile back in one batch
+        drawPile.add(discardPile.takeFirst(discardPile.length()), CardArea::Bottom);
+        moveNum += cardNum * 3;
+    }
+    qint64 nsecs = timer.nsecsElapsed();
+
+    QTextStream out(stdout);
+    out << "cards:  " << cardNum << endl;
+    out << "rounds: " << roundNum << endl;
+    out << "moves:  " << moveNum << " in " << nsecs / 1e6 << " ms (" << (moveNum > 0 ? double(nsecs) / moveNum : 0.0) << " ns/move)" << endl;
+}
@@ -0,0 +1,26 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+#ifndef CARDAREABENCHMARK_H
+#define CARDAREABENCHMARK_H
+
+//Moves the whole deck between a draw pile, a hand and a discard pile for a number of rounds and reports the time per card move
+void RunCardAreaBenchmark(int roundNum);
+
+#endif // CARDAREABENCHMARK_H
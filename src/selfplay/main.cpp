@@ -0,0 +1,79 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+
+#include "cardareabenchmark.h"
+#include "simulation.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QThread>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    app.setOrganizationName("Mogara");
+    app.setOrganizationDomain("mogara.org");
+    app.setApplicationName("QSanguosha-selfplay");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Plays games between robots and reports the throughput of the game logic");
+    parser.addHelpOption();
+
+    QCommandLineOption gameOption(QStringList() << "n" << "games", "Number of games to play (default: 100).", "number", "100");
+    QCommandLineOption jobOption(QStringList() << "j" << "jobs", "Number of games played in parallel (default: number of cores).", "number", QString::number(qMax(QThread::idealThreadCount(), 1)));
+    QCommandLineOption workerOption("workers", "Run the games as coroutines on a number of worker threads, 0 for one thread per game (default: 0).", "number", "0");
+    //Every player gets 7 candidate generals, so the general pool limits the number of players
+    QCommandLineOption playerOption("players", "Number of players in a game (default: 2).", "number", "2");
+    QCommandLineOption roundOption("rounds", "Number of rounds a game lasts (default: 20).", "number", "20");
+    //Compare the turn throughput of --break-turns 0 and, say, --break-turns 50 to measure the cost of interruptions
+    QCommandLineOption breakOption("break-turns", "Percentage of play phases that break the turn (default: 0).", "percent", "0");
+    QCommandLineOption cardAreaOption("card-area", "Benchmark moving the deck between card areas for a number of rounds instead of playing games.", "rounds");
+    QCommandLineOption seedOption("seed", "Play game i with seed + i to reproduce a run.", "seed");
+    parser.addOption(gameOption);
+    parser.addOption(jobOption);
+    parser.addOption(workerOption);
+    parser.addOption(playerOption);
+    parser.addOption(roundOption);
+    parser.addOption(breakOption);
+    parser.addOption(seedOption);
+    parser.addOption(cardAreaOption);
+    parser.process(app);
+
+    if (parser.isSet(cardAreaOption)) {
+        RunCardAreaBenchmark(qMax(parser.value(cardAreaOption).toInt(), 1));
+        return 0;
+    }
+
+    Simulation simulation;
+    simulation.setGameNum(qMax(parser.value(gameOption).toInt(), 1));
+    simulation.setJobNum(qMax(parser.value(jobOption).toInt(), 1));
+    simulation.setWorkerNum(qMax(parser.value(workerOption).toInt(), 0));
+    simulation.setPlayerNum(qBound(2, parser.value(playerOption).toInt(), 8));
+    simulation.setRoundLimit(qMax(parser.value(roundOption).toInt(), 1));
+    simulation.setBreakRate(qBound(0, parser.value(breakOption).toInt(), 100));
+    if (parser.isSet(seedOption))
+        simulation.setSeed(parser.value(seedOption).toULongLong());
+
+    QObject::connect(&simulation, &Simulation::finished, &app, &QCoreApplication::quit);
+    simulation.start();
+
+    return app.exec();
+}
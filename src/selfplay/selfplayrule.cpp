@@ -0,0 +1,73 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+
+#include "card.h"
+#include "cardarea.h"
+#include "gamelogic.h"
+#include "selfplayrule.h"
+#include "serverplayer.h"
+
+SelfPlayRule::SelfPlayRule(GameLogic *logic, int roundLimit)
+    : GameRule(logic)
+    , m_roundLimit(roundLimit)
+    , m_breakRate(0)
+    , m_turnNum(0)
+    , m_brokenTurnNum(0)
+{
+}
+
+bool SelfPlayRule::effect(GameLogic *logic, EventType event, ServerPlayer *current, EventData &data, Player *invoker) const
+{
+    if (event == TurnStart) {
+        if (logic->round() > m_roundLimit) {
+            logic->interrupt(GameFinish);
+            return false;
+        }
+        m_turnNum++;
+    } else if (event == PhaseProceeding && current->phase() == Player::Play) {
+        play(current);
+        if (m_breakRate > 0 && int(logic->random().bounded(100)) < m_breakRate) {
+            logic->interrupt(TurnBroken);
+            m_brokenTurnNum++;
+        }
+        return false;
+    }
+
+    return GameRule::effect(logic, event, current, data, invoker);
+}
+
+void SelfPlayRule::play(ServerPlayer *current) const
+{
+    ServerPlayer *target = current->nextAlive();
+    if (target == nullptr || target == current)
+        return;
+
+    const QList<const Card *> &handcards = current->handcards()->cards();
+    foreach (const Card *card, handcards) {
+        if (card->objectName() == "slash") {
+            CardUseStruct use;
+            use.from = current;
+            use.card = card;
+            use.to << target;
+            m_logic->useCard(use);
+            break;
+        }
+    }
+}
@@ -0,0 +1,50 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+
+#ifndef SELFPLAYRULE_H
+#define SELFPLAYRULE_H
+
+#include "gamerule.h"
+
+//Game rule of simulated games. Instead of asking the agents, every player slashes the next alive player once in the play phase.
+//GameLogic has no winning condition yet, so the game finishes after a number of rounds.
+class SelfPlayRule : public GameRule
+{
+public:
+    SelfPlayRule(GameLogic *logic, int roundLimit);
+
+    //Percentage of play phases that break the turn, to measure the cost of interruptions
+    void setBreakRate(int percent) { m_breakRate = percent; }
+
+    bool effect(GameLogic *logic, EventType event, ServerPlayer *current, EventData &data, Player *) const override;
+
+    int turnNum() const { return m_turnNum; }
+    int brokenTurnNum() const { return m_brokenTurnNum; }
+
+private:
+    void play(ServerPlayer *current) const;
+
+    int m_roundLimit;
+    int m_breakRate;
+    mutable int m_turnNum;
+    mutable int m_brokenTurnNum;
+};
+
+#endif // SELFPLAYRULE_H
@@ -0,0 +1,132 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+
+#include "engine.h"
+#include "gamelogic.h"
+#include "logicscheduler.h"
+#include "selfplayrule.h"
+#include "simulation.h"
+
+#include <cserver.h>
+#include <croom.h>
+#include <cserverrobot.h>
+
+#include <QTextStream>
+
+Simulation::Simulation(QObject *parent)
+    : QObject(parent)
+    , m_server(new CServer(this))
+    , m_scheduler(nullptr)
+    , m_gameNum(1)
+    , m_jobNum(1)
+    , m_playerNum(2)
+    , m_roundLimit(20)
+    , m_breakRate(0)
+    , m_seed(0)
+    , m_startedNum(0)
+    , m_finishedNum(0)
+    , m_turnNum(0)
+    , m_brokenTurnNum(0)
+    , m_triggerNum(0)
+    , m_moveNum(0)
+{
+}
+
+Simulation::~Simulation()
+{
+    //The games still running are cancelled and unwound while their rooms exist
+    delete m_scheduler;
+    delete m_server;
+}
+
+void Simulation::setWorkerNum(int num)
+{
+    delete m_scheduler;
+    m_scheduler = num > 0 ? new LogicScheduler(num) : nullptr;
+}
+
+void Simulation::start()
+{
+    m_timer.start();
+    int jobNum = qMin(m_jobNum, m_gameNum);
+    for (int i = 0; i < jobNum; i++)
+        startGame();
+}
+
+void Simulation::startGame()
+{
+    int index = m_startedNum++;
+
+    CRoom *room = new CRoom(m_server);
+    for (int i = 0; i < m_playerNum; i++)
+        room->addRobot(new CServerRobot(room));
+
+    GameLogic *logic = new GameLogic(room);
+    SelfPlayRule *rule = new SelfPlayRule(logic, m_roundLimit);
+    rule->setBreakRate(m_breakRate);
+    logic->setGameRule(rule);
+    logic->setPackages(Engine::instance()->packages());
+    //Robots never reply, so requests must not wait
+    logic->setRequestTimeout(0);
+    logic->setFastForward(true);
+    logic->setScheduler(m_scheduler);
+    if (m_seed != 0)
+        logic->setSeed(m_seed + index);
+    room->setGameLogic(logic);
+
+    connect(logic, &GameLogic::finished, this, &Simulation::onGameFinished);
+    room->startGame();
+}
+
+void Simulation::onGameFinished()
+{
+    GameLogic *logic = qobject_cast<GameLogic *>(sender());
+    if (logic == nullptr)
+        return;
+
+    const SelfPlayRule *rule = static_cast<const SelfPlayRule *>(logic->gameRule());
+    m_turnNum += rule->turnNum();
+    m_brokenTurnNum += rule->brokenTurnNum();
+    m_triggerNum += logic->dispatchedTriggerNum();
+    m_moveNum += logic->moveNum();
+    m_finishedNum++;
+
+    logic->room()->deleteLater();
+
+    if (m_startedNum < m_gameNum)
+        startGame();
+    else if (m_finishedNum == m_gameNum)
+        report();
+}
+
+void Simulation::report()
+{
+    double seconds = m_timer.nsecsElapsed() / 1e9;
+    if (seconds <= 0)
+        seconds = 1e-9;
+
+    QTextStream out(stdout);
+    out << "games:    " << m_finishedNum << " in " << seconds << " s (" << m_finishedNum / seconds << " games/sec)" << endl;
+    out << "turns:    " << m_turnNum << " (" << m_turnNum / seconds << " turns/sec, " << m_brokenTurnNum << " broken)" << endl;
+    out << "triggers: " << m_triggerNum << " (" << m_triggerNum / seconds << " triggers/sec)" << endl;
+    out << "moves:    " << m_moveNum << " (" << m_moveNum / seconds << " moves/sec)" << endl;
+
+    emit finished();
+}
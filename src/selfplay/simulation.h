@@ -0,0 +1,79 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <QElapsedTimer>
+#include <QObject>
+
+class CServer;
+class GameLogic;
+class LogicScheduler;
+
+//Plays games between robots and reports the throughput of the game logic
+class Simulation : public QObject
+{
+    Q_OBJECT
+
+public:
+    Simulation(QObject *parent = 0);
+    ~Simulation();
+
+    void setGameNum(int num) { m_gameNum = num; }
+    void setJobNum(int num) { m_jobNum = num; }
+    //Games run on a pool of worker threads if num > 0, or on a thread per game
+    void setWorkerNum(int num);
+    void setPlayerNum(int num) { m_playerNum = num; }
+    void setRoundLimit(int limit) { m_roundLimit = limit; }
+    //Percentage of play phases that break the turn
+    void setBreakRate(int percent) { m_breakRate = percent; }
+    //Game i is played with seed + i. Random seeds are used if it is 0.
+    void setSeed(quint64 seed) { m_seed = seed; }
+
+    void start();
+
+signals:
+    void finished();
+
+private:
+    void startGame();
+    void onGameFinished();
+    void report();
+
+    CServer *m_server;
+    LogicScheduler *m_scheduler;
+    int m_gameNum;
+    int m_jobNum;
+    int m_playerNum;
+    int m_roundLimit;
+    int m_breakRate;
+    quint64 m_seed;
+
+    int m_startedNum;
+    int m_finishedNum;
+    quint64 m_turnNum;
+    quint64 m_brokenTurnNum;
+    quint64 m_triggerNum;
+    quint64 m_moveNum;
+    QElapsedTimer m_timer;
+};
+
+#endif // SIMULATION_H
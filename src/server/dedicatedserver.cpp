@@ -0,0 +1,123 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+
+#include "dedicatedserver.h"
+#include "engine.h"
+#include "gamelogic.h"
+#include "gamerule.h"
+#include "logicscheduler.h"
+
+#include <cserver.h>
+#include <croom.h>
+#include <cserveruser.h>
+
+DedicatedServer::DedicatedServer(QObject *parent)
+    : QObject(parent)
+    , m_server(nullptr)
+    , m_maxRoomNum(0)
+    , m_requestTimeout(15000)
+    , m_scheduler(nullptr)
+{
+}
+
+DedicatedServer::~DedicatedServer()
+{
+    //The games still running are cancelled and unwound while their rooms exist
+    delete m_scheduler;
+    delete m_server;
+}
+
+void DedicatedServer::setWorkerNum(int num)
+{
+    delete m_scheduler;
+    m_scheduler = num > 0 ? new LogicScheduler(num) : nullptr;
+}
+
+bool DedicatedServer::listen(const QHostAddress &address, ushort port)
+{
+    m_server = new CServer(this);
+    if (!m_server->listen(address, port)) {
+        qWarning("The server failed to start, probably due to port %u occupied by another application.", port);
+        delete m_server;
+        m_server = nullptr;
+        return false;
+    }
+
+    CRoom *lobby = m_server->lobby();
+    lobby->setName(tr("QSanguosha Lobby"));
+
+    qDebug("The server is listening on port %u", port);
+
+    connect(m_server, &CServer::userAdded, this, &DedicatedServer::onUserAdded);
+    connect(m_server, &CServer::roomCreated, this, &DedicatedServer::onRoomCreated);
+    return true;
+}
+
+void DedicatedServer::onUserAdded(CServerUser *user)
+{
+    qDebug("User %s(%u) logged in.", qPrintable(user->screenName()), user->id());
+    connect(user, &CServerUser::disconnected, this, &DedicatedServer::onUserRemoved);
+}
+
+void DedicatedServer::onUserRemoved()
+{
+    CServerUser *user = qobject_cast<CServerUser *>(sender());
+    if (user == nullptr)
+        return;
+    qDebug("User %s(%u) logged out.", qPrintable(user->screenName()), user->id());
+}
+
+void DedicatedServer::onRoomCreated(CRoom *room)
+{
+    connect(room, &CRoom::abandoned, this, &DedicatedServer::onRoomAbandoned);
+
+    CServerUser *owner = room->owner();
+    room->setName(tr("%1's Room").arg(owner->screenName()));
+
+    //A room without a game logic would stay open for nothing, so its owner is told and sent back to the lobby.
+    //The room is closed once it is empty.
+    if (m_maxRoomNum > 0 && m_gameRooms.size() >= m_maxRoomNum) {
+        qWarning("Room limit (%d) reached. Room %u of %s(%u) is closed.", m_maxRoomNum, room->id(), qPrintable(owner->screenName()), owner->id());
+        room->broadcastSystemMessage(tr("The server is hosting as many games as it can (%1). Please try again later.").arg(m_maxRoomNum));
+        m_server->lobby()->addUser(owner);
+        return;
+    }
+    m_gameRooms.insert(room->id());
+
+    GameLogic *logic = new GameLogic(room);
+    logic->setGameRule(new GameRule(logic));
+    logic->setRequestTimeout(m_requestTimeout);
+    logic->setScheduler(m_scheduler);
+    logic->setJournalDirectory(m_journalDirectory);
+    Engine *engine = Engine::instance();
+    logic->setPackages(engine->packages());
+    room->setGameLogic(logic);
+
+    qDebug("%s(%u) created a new room(%u)", qPrintable(owner->screenName()), owner->id(), room->id());
+}
+
+void DedicatedServer::onRoomAbandoned()
+{
+    CRoom *room = qobject_cast<CRoom *>(sender());
+    if (room == nullptr)
+        return;
+    m_gameRooms.remove(room->id());
+    qDebug("Room(%u) became empty and thus closed.", room->id());
+}
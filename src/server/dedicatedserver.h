@@ -0,0 +1,73 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+
+#ifndef DEDICATEDSERVER_H
+#define DEDICATEDSERVER_H
+
+#include <QObject>
+#include <QHostAddress>
+#include <QSet>
+
+class CServer;
+class CServerUser;
+class CRoom;
+class LogicScheduler;
+
+//Server without any user interface. Rooms get a game logic the same way StartServerDialog sets them up.
+class DedicatedServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    DedicatedServer(QObject *parent = 0);
+    ~DedicatedServer();
+
+    //Rooms with a game, 0 means unlimited. The owners of rooms past the limit are sent back to the lobby.
+    void setMaxRoomNum(int num) { m_maxRoomNum = num; }
+    int maxRoomNum() const { return m_maxRoomNum; }
+
+    void setRequestTimeout(int timeout) { m_requestTimeout = timeout; }
+    int requestTimeout() const { return m_requestTimeout; }
+
+    //Games run on a pool of worker threads shared by all rooms if num > 0, or on a thread per room
+    void setWorkerNum(int num);
+
+    //Each room writes a journal into the directory if it is set
+    void setJournalDirectory(const QString &path) { m_journalDirectory = path; }
+    QString journalDirectory() const { return m_journalDirectory; }
+
+    bool listen(const QHostAddress &address, ushort port);
+
+private:
+    void onUserAdded(CServerUser *user);
+    void onUserRemoved();
+    void onRoomCreated(CRoom *room);
+    void onRoomAbandoned();
+
+    CServer *m_server;
+    int m_maxRoomNum;
+    //Ids of the open rooms with a game logic, which are limited by m_maxRoomNum
+    QSet<uint> m_gameRooms;
+    int m_requestTimeout;
+    QString m_journalDirectory;
+    LogicScheduler *m_scheduler;
+};
+
+#endif // DEDICATEDSERVER_H
@@ -0,0 +1,93 @@
+/********************************************************************
+    Copyright (c) 2013-2015 - Mogara
+
+    This file is part of QSanguosha.
+
+    This game engine is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 3.0
+    of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    See the LICENSE file for more details.
+
+    Mogara
+*********************************************************************/
+
+
+#include "dedicatedserver.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QSettings>
+
+#include <cexceptionhandler.h>
+
+int main(int argc, char *argv[])
+{
+    CExceptionHandler eh("./dmp");
+
+    QCoreApplication app(argc, argv);
+
+    app.setOrganizationName("Mogara");
+    app.setOrganizationDomain("mogara.org");
+    app.setApplicationName("QSanguosha-server");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("QSanguosha dedicated server");
+    parser.addHelpOption();
+
+    QCommandLineOption configOption(QStringList() << "c" << "config", "Read the settings from an INI file.", "file");
+    QCommandLineOption portOption(QStringList() << "p" << "port", "Port to listen on (default: 5927).", "port");
+    QCommandLineOption maxRoomOption("max-rooms", "Maximum number of rooms with a game, 0 for unlimited (default: 0).", "number");
+    QCommandLineOption timeoutOption("timeout", "Milliseconds a player has to reply to a request (default: 15000).", "msecs");
+    QCommandLineOption workerOption("workers", "Run the games of all rooms on a number of worker threads, 0 for one thread per room (default: 0).", "number");
+    QCommandLineOption journalOption("journal-dir", "Record a journal of every game into the directory.", "path");
+    parser.addOption(configOption);
+    parser.addOption(portOption);
+    parser.addOption(maxRoomOption);
+    parser.addOption(timeoutOption);
+    parser.addOption(workerOption);
+    parser.addOption(journalOption);
+    parser.process(app);
+
+    //Command line options override the config file
+    QVariantMap config;
+    config["port"] = 5927;
+    config["maxRooms"] = 0;
+    config["timeout"] = 15000;
+    config["workers"] = 0;
+    config["journalDir"] = QString();
+
+    if (parser.isSet(configOption)) {
+        QSettings settings(parser.value(configOption), QSettings::IniFormat);
+        foreach (const QString &key, config.keys()) {
+            if (settings.contains(key))
+                config[key] = settings.value(key);
+        }
+    }
+
+    if (parser.isSet(portOption))
+        config["port"] = parser.value(portOption);
+    if (parser.isSet(maxRoomOption))
+        config["maxRooms"] = parser.value(maxRoomOption);
+    if (parser.isSet(timeoutOption))
+        config["timeout"] = parser.value(timeoutOption);
+    if (parser.isSet(workerOption))
+        config["workers"] = parser.value(workerOption);
+    if (parser.isSet(journalOption))
+        config["journalDir"] = parser.value(journalOption);
+
+    DedicatedServer server;
+    server.setMaxRoomNum(config["maxRooms"].toInt());
+    server.setRequestTimeout(config["timeout"].toInt());
+    server.setWorkerNum(config["workers"].toInt());
+    server.setJournalDirectory(config["journalDir"].toString());
+    if (!server.listen(QHostAddress::Any, config["port"].toUInt()))
+        return 1;
+
+    return app.exec();
+}